@@ -0,0 +1,101 @@
+#pragma once
+
+#include "BBox.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// uniform-grid broad phase for the (yaw-only) vehicle bounding boxes
+// every box is binned by the (x, y) cell of its midpt, where the cell size is the
+// largest bounding-circle diameter of all boxes, so any two boxes that can touch
+// are guaranteed to live in the same or in adjacent cells
+class SpatialHash {
+public:
+    // rebuild the grid from scratch and fill "pairs" with every (i < j) pair of boxes
+    // whose bounding circles and z-ranges overlap. Only these need the narrow phase
+    void find_pairs(const std::vector<const BBox*>& boxes)
+    {
+        pairs.clear();
+        cells.clear();
+        radii.resize(boxes.size());
+
+        float max_radius = 0.f;
+        for (size_t i = 0; i < boxes.size(); i++) {
+            // furthest a point of this box can be from its midpt in the ground plane
+            // (contains_pt measures [min0, max0] from midpt, so this is not always extent / 2)
+            const glm::vec2 reach = glm::max(glm::abs(glm::vec2(boxes[i]->min0)), glm::abs(glm::vec2(boxes[i]->max0)));
+            radii[i] = glm::length(reach);
+            max_radius = std::max(max_radius, radii[i]);
+        }
+        cell_size = std::max(2.f * max_radius, 1e-3f);
+
+        cells.reserve(boxes.size());
+        for (size_t i = 0; i < boxes.size(); i++) {
+            const glm::ivec2 cell = get_cell(boxes[i]->midpt);
+            cells.emplace_back(get_key(cell.x, cell.y), uint32_t(i));
+        }
+        // sorting groups the boxes by cell so every cell is a contiguous run
+        std::sort(cells.begin(), cells.end());
+
+        // only visit half of the neighbourhood so every pair is emitted exactly once
+        constexpr int neighbours[4][2] = { { 1, -1 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+        for (size_t c = 0; c < cells.size(); c++) {
+            const uint32_t i = cells[c].second;
+            const glm::ivec2 cell = get_cell(boxes[i]->midpt);
+
+            // rest of the same cell
+            for (size_t d = c + 1; d < cells.size() && cells[d].first == cells[c].first; d++) {
+                test_pair(boxes, i, cells[d].second);
+            }
+
+            // adjacent cells
+            for (const auto& n : neighbours) {
+                const uint64_t key = get_key(cell.x + n[0], cell.y + n[1]);
+                auto it = std::lower_bound(cells.begin(), cells.end(), std::make_pair(key, uint32_t(0)));
+                for (; it != cells.end() && it->first == key; it++) {
+                    test_pair(boxes, i, it->second);
+                }
+            }
+        }
+    }
+
+    // candidate pairs (indices into the boxes passed to find_pairs), always first < second
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+
+private:
+    glm::ivec2 get_cell(const glm::vec3& pt) const
+    {
+        return glm::ivec2(int(std::floor(pt.x / cell_size)), int(std::floor(pt.y / cell_size)));
+    }
+
+    static uint64_t get_key(int x, int y)
+    {
+        return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y));
+    }
+
+    void test_pair(const std::vector<const BBox*>& boxes, uint32_t i, uint32_t j)
+    {
+        const BBox& a = *boxes[i];
+        const BBox& b = *boxes[j];
+        // bounding circles in the ground plane
+        const glm::vec2 d = glm::vec2(a.midpt - b.midpt);
+        const float r = radii[i] + radii[j];
+        if (glm::dot(d, d) > r * r) {
+            return;
+        }
+        // boxes are always upright, so their z-ranges must overlap too
+        if (std::fabs(a.midpt.z - b.midpt.z) > 0.5f * (a.extent.z + b.extent.z)) {
+            return;
+        }
+        pairs.emplace_back(std::min(i, j), std::max(i, j));
+    }
+
+    float cell_size = 1.f;
+    std::vector<float> radii;
+    std::vector<std::pair<uint64_t, uint32_t>> cells; // (cell key, box index)
+};
@@ -36,10 +36,50 @@ ColorProgram::ColorProgram() {
 
 	//look up the locations of uniforms:
 	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
+
+	//instanced boxes: no vertex attributes at all, so the cpu only supplies a transform and color per box:
+	box_program = gl_compile_program(
+		//vertex shader:
+		"#version 330\n"
+		"uniform mat4 OBJECT_TO_CLIP;\n"
+		"uniform samplerBuffer INSTANCES;\n"
+		"uniform int INSTANCE_BASE;\n"
+		"out vec4 color;\n"
+		"void main() {\n"
+		"	int base = 4 * (INSTANCE_BASE + gl_InstanceID);\n"
+		"	mat4x3 BOX_TO_OBJECT = transpose(mat3x4(\n"
+		"		texelFetch(INSTANCES, base+0), texelFetch(INSTANCES, base+1), texelFetch(INSTANCES, base+2)\n"
+		"	));\n"
+		//twelve edges, four along each axis; (u,v) pick the edge, 'along' picks the end:
+		"	int edge = gl_VertexID / 2;\n"
+		"	vec3 uv_along = vec3(float(edge & 1), float((edge >> 1) & 1), float(gl_VertexID & 1));\n"
+		"	int axis = edge / 4;\n"
+		"	vec3 corner = (axis == 0 ? uv_along.zxy : (axis == 1 ? uv_along.xzy : uv_along.xyz));\n"
+		"	gl_Position = OBJECT_TO_CLIP * vec4(BOX_TO_OBJECT * vec4(2.0 * corner - 1.0, 1.0), 1.0);\n"
+		"	color = texelFetch(INSTANCES, base+3);\n"
+		"}\n"
+	,
+		//fragment shader:
+		"#version 330\n"
+		"in vec4 color;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	fragColor = color;\n"
+		"}\n"
+	);
+
+	box_OBJECT_TO_CLIP_mat4 = glGetUniformLocation(box_program, "OBJECT_TO_CLIP");
+	box_INSTANCE_BASE_int = glGetUniformLocation(box_program, "INSTANCE_BASE");
+
+	glUseProgram(box_program);
+	glUniform1i(glGetUniformLocation(box_program, "INSTANCES"), 0); //GL_TEXTURE0
+	glUseProgram(0);
 }
 
 ColorProgram::~ColorProgram() {
 	glDeleteProgram(program);
 	program = 0;
+	glDeleteProgram(box_program);
+	box_program = 0;
 }
 
@@ -16,6 +16,15 @@ struct ColorProgram {
 	GLuint OBJECT_TO_CLIP_mat4 = -1U;
 	//Textures:
 	// none
+
+	//Instanced wireframe boxes: the [-1,1]^3 cube's edges (24 vertices, from gl_VertexID), transformed per instance:
+	// (per-instance data is four texels in a buffer texture: the three rows of a mat4x3, then a color)
+	GLuint box_program = 0;
+	//Uniform locations:
+	GLuint box_OBJECT_TO_CLIP_mat4 = -1U;
+	GLuint box_INSTANCE_BASE_int = -1U;
+	//Textures:
+	// TEXTURE0 - samplerBuffer of instance data
 };
 
 extern Load< ColorProgram > color_program;
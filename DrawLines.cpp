@@ -1,17 +1,56 @@
 #include "DrawLines.hpp"
 #include "PathFont.hpp"
 #include "ColorProgram.hpp"
+#include "GPUTimer.hpp"
+#include "Profiler.hpp"
 
 #include "gl_errors.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <unordered_map>
+
 //All DrawLines instances share a vertex array object and vertex buffer, initialized at load time:
 
 //n.b. declared static so they don't conflict with similarly named global variables elsewhere:
 static GLuint vertex_buffer = 0;
 static GLuint vertex_buffer_for_color_program = 0;
 
+//vertex_buffer is used as a ring:
+// each flush() writes the next range through an unsynchronized map (so there are no reallocations or driver stalls),
+// and fences keep it from overwriting ranges that the GPU may still be drawing from.
+static GLsizeiptr ring_size = 0; //bytes allocated for vertex_buffer
+static GLintptr ring_head = 0; //next byte to write
+struct RingFence {
+	GLsync sync;
+	GLintptr begin, end; //range read by the draws before the fence
+};
+static std::vector< RingFence > ring_fences;
+static constexpr GLsizeiptr RingFrames = 4; //ring holds (at least) this many frames' worth of lines
+
+//DrawLines finished since the last flush():
+struct LineBatch {
+	glm::mat4 world_to_clip;
+	GLint first; //of the batch's vertices in frame_attribs
+	GLsizei count;
+	GLint first_box; //of the batch's boxes in frame_box_texels (four texels each)
+	GLsizei box_count;
+	bool with_bg;
+	bool depth_test;
+	char const *gpu_pass;
+};
+static std::vector< DrawLines::Vertex > frame_attribs;
+static std::vector< glm::vec4 > frame_box_texels;
+static std::vector< LineBatch > frame_batches;
+
+//box instance data is streamed through a buffer texture (like Scene's instanced drawables):
+static GLuint box_buffer = 0;
+static GLuint box_texture = 0;
+static GLuint empty_vao = 0; //box_program has no attributes, but a vao must be bound to draw
+
 static Load< void > setup_buffers(LoadTagDefault, [](){
 	//you may recognize this init code from DrawSprites.cpp:
 
@@ -60,6 +99,19 @@ static Load< void > setup_buffers(LoadTagDefault, [](){
 		glBindVertexArray(0);
 	}
 
+	{ //buffer texture for box instances, and a vao to draw them with:
+		glGenBuffers(1, &box_buffer);
+		glGenTextures(1, &box_texture);
+		glBindBuffer(GL_TEXTURE_BUFFER, box_buffer);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4), nullptr, GL_STREAM_DRAW); //(not empty, so the texture is complete)
+		glBindTexture(GL_TEXTURE_BUFFER, box_texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, box_buffer);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		glGenVertexArrays(1, &empty_vao);
+	}
+
 	GL_ERRORS(); //PARANOIA: make sure nothing strange happened during setup
 });
 
@@ -86,44 +138,35 @@ void DrawLines::draw(glm::vec3 const &a, glm::vec3 const &b, glm::u8vec4 const &
 }
 
 void DrawLines::draw_box(glm::mat4x3 const &mat, glm::u8vec4 const &color) {
-	//draw cube as three edge sets:
-
-	draw(mat * glm::vec4(-1.0f,-1.0f,-1.0f, 1.0f), mat * glm::vec4( 1.0f,-1.0f,-1.0f, 1.0f), color);
-	draw(mat * glm::vec4(-1.0f, 1.0f,-1.0f, 1.0f), mat * glm::vec4( 1.0f, 1.0f,-1.0f, 1.0f), color);
-	draw(mat * glm::vec4(-1.0f,-1.0f, 1.0f, 1.0f), mat * glm::vec4( 1.0f,-1.0f, 1.0f, 1.0f), color);
-	draw(mat * glm::vec4(-1.0f, 1.0f, 1.0f, 1.0f), mat * glm::vec4( 1.0f, 1.0f, 1.0f, 1.0f), color);
-
-	draw(mat * glm::vec4(-1.0f,-1.0f,-1.0f, 1.0f), mat * glm::vec4(-1.0f, 1.0f,-1.0f, 1.0f), color);
-	draw(mat * glm::vec4( 1.0f,-1.0f,-1.0f, 1.0f), mat * glm::vec4( 1.0f, 1.0f,-1.0f, 1.0f), color);
-	draw(mat * glm::vec4(-1.0f,-1.0f, 1.0f, 1.0f), mat * glm::vec4(-1.0f, 1.0f, 1.0f, 1.0f), color);
-	draw(mat * glm::vec4( 1.0f,-1.0f, 1.0f, 1.0f), mat * glm::vec4( 1.0f, 1.0f, 1.0f, 1.0f), color);
-	
-	draw(mat * glm::vec4(-1.0f,-1.0f,-1.0f, 1.0f), mat * glm::vec4(-1.0f,-1.0f, 1.0f, 1.0f), color);
-	draw(mat * glm::vec4( 1.0f,-1.0f,-1.0f, 1.0f), mat * glm::vec4( 1.0f,-1.0f, 1.0f, 1.0f), color);
-	draw(mat * glm::vec4(-1.0f, 1.0f,-1.0f, 1.0f), mat * glm::vec4(-1.0f, 1.0f, 1.0f, 1.0f), color);
-	draw(mat * glm::vec4( 1.0f, 1.0f,-1.0f, 1.0f), mat * glm::vec4( 1.0f, 1.0f, 1.0f, 1.0f), color);
+	//queue the box for an instanced draw (see ColorProgram::box_program):
+	for (uint32_t r = 0; r < 3; ++r) {
+		box_texels.emplace_back(mat[0][r], mat[1][r], mat[2][r], mat[3][r]);
+	}
+	box_texels.emplace_back(glm::vec4(color) / 255.0f);
 }
 
-void DrawLines::draw_text(std::string const &text, glm::vec3 const &anchor_in, glm::vec3 const &x, glm::vec3 const &y, glm::u8vec4 const &color, glm::vec3 *anchor_out) {
+//draw_text lays text out (in units of the x and y vectors) once, and re-uses the layout while the text stays the same:
+struct TextLayout {
+	std::vector< glm::vec2 > points; //line segment endpoints
+	float advance = 0.0f; //total width
+};
+static TextLayout const &layout_text(std::string const &text) {
+	static std::unordered_map< std::string, TextLayout > cache;
+	auto f = cache.find(text);
+	if (f != cache.end()) return f->second;
+
+	//text that changes all the time (e.g., counters) shouldn't grow the cache forever:
+	if (cache.size() >= 256) cache.clear();
 
-	glm::vec3 anchor = anchor_in;
+	TextLayout &layout = cache[text];
+	PathFont const &font = PathFont::font;
+	float anchor = 0.0f;
 
 	uint32_t start = 0;
 	while (start < text.size()) {
-		uint32_t end = start;
-		uint32_t glyph = -1U;
-		while (end < text.size()) {
-			end += 1;
-			auto f = PathFont::font.glyph_map.find(text.substr(start, end-start));
-			if (f == PathFont::font.glyph_map.end()) {
-				end -= 1;
-				break;
-			}
-			glyph = f->second;
-		}
+		uint32_t length = 1;
+		uint32_t glyph = font.match(text.data() + start, text.data() + text.size(), &length);
 		if (glyph == -1U) {
-			assert(start == end);
-			end += 1;
 			//missing! draw a tofu:
 			for (const auto &pt : {
 				glm::vec2(0.1f, 0.1f), glm::vec2(0.6f, 0.1f),
@@ -131,53 +174,176 @@ void DrawLines::draw_text(std::string const &text, glm::vec3 const &anchor_in, g
 				glm::vec2(0.9f, 0.6f), glm::vec2(0.1f, 0.9f),
 				glm::vec2(0.1f, 0.9f), glm::vec2(0.1f, 0.1f)
 			}) {
-				attribs.emplace_back(anchor + pt.x * x + pt.y * y, color);
+				layout.points.emplace_back(anchor + pt.x, pt.y);
 			}
-			anchor += x * 0.6f;
+			anchor += 0.6f;
 		} else {
-			for (uint32_t c = PathFont::font.glyph_coord_starts[glyph]; c + 1 < PathFont::font.glyph_coord_starts[glyph+1]; c += 2) {
-				attribs.emplace_back(anchor + x * PathFont::font.coords[c] + y * PathFont::font.coords[c+1], color);
+			for (uint32_t c = font.glyph_coord_starts[glyph]; c + 1 < font.glyph_coord_starts[glyph+1]; c += 2) {
+				layout.points.emplace_back(anchor + font.coords[c], font.coords[c+1]);
 			}
-			anchor += x * PathFont::font.glyph_widths[glyph];
+			anchor += font.glyph_widths[glyph];
 		}
-		start = end;
+		start += length;
 	}
+	layout.advance = anchor;
 
-	if (anchor_out) *anchor_out = anchor;
+	return layout;
+}
+
+void DrawLines::draw_text(std::string const &text, glm::vec3 const &anchor, glm::vec3 const &x, glm::vec3 const &y, glm::u8vec4 const &color, glm::vec3 *anchor_out) {
+	TextLayout const &layout = layout_text(text);
+
+	for (auto const &pt : layout.points) {
+		attribs.emplace_back(anchor + pt.x * x + pt.y * y, color);
+	}
+
+	if (anchor_out) *anchor_out = anchor + layout.advance * x;
 }
 
 DrawLines::~DrawLines() {
-	if (attribs.empty()) return;
+	if (attribs.empty() && box_texels.empty()) return;
+
+	//queue for flush():
+	LineBatch batch;
+	batch.world_to_clip = world_to_clip;
+	batch.first = GLint(frame_attribs.size());
+	batch.count = GLsizei(attribs.size());
+	batch.first_box = GLint(frame_box_texels.size() / 4);
+	batch.box_count = GLsizei(box_texels.size() / 4);
+	batch.with_bg = with_bg;
+	batch.depth_test = (glIsEnabled(GL_DEPTH_TEST) == GL_TRUE);
+	batch.gpu_pass = gpu_pass;
+	frame_batches.emplace_back(batch);
+	frame_attribs.insert(frame_attribs.end(), attribs.begin(), attribs.end());
+	frame_box_texels.insert(frame_box_texels.end(), box_texels.begin(), box_texels.end());
+}
 
-	//based on DrawSprites.cpp :
+void DrawLines::flush() {
+	if (frame_batches.empty()) return;
+	PROFILE_ZONE("DrawLines::flush");
 
-	//upload vertices to vertex_buffer:
+	//a batch might have only boxes, so make sure there's something to upload:
+	// (n.b. this also keeps the ring range below non-empty)
+	if (frame_attribs.empty()) frame_attribs.emplace_back(glm::vec3(0.0f), glm::u8vec4(0x00));
+
+	GLsizeiptr bytes = GLsizeiptr(frame_attribs.size() * sizeof(Vertex));
 	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer); //set vertex_buffer as current
-	glBufferData(GL_ARRAY_BUFFER, attribs.size() * sizeof(attribs[0]), attribs.data(), GL_STREAM_DRAW); //upload attribs array
+
+	//(re-)allocate the ring if this frame doesn't fit comfortably:
+	if (bytes * RingFrames > ring_size) {
+		ring_size = 1 << 16;
+		while (ring_size < bytes * RingFrames) ring_size *= 2;
+		glBufferData(GL_ARRAY_BUFFER, ring_size, nullptr, GL_STREAM_DRAW); //(orphans the old storage, so old fences don't matter)
+		for (auto const &fence : ring_fences) glDeleteSync(fence.sync);
+		ring_fences.clear();
+		ring_head = 0;
+	}
+
+	//write at the head of the ring, wrapping to the start if needed:
+	// (ring_size and bytes are multiples of sizeof(Vertex), so vertices never straddle the wrap)
+	if (ring_head + bytes > ring_size) ring_head = 0;
+	GLintptr begin = ring_head;
+	GLintptr end = ring_head + bytes;
+
+	//wait for the GPU to finish with anything that used this range (usually long done, frames ago):
+	for (auto fence = ring_fences.begin(); fence != ring_fences.end(); /* later */) {
+		if (fence->begin < end && begin < fence->end) {
+			glClientWaitSync(fence->sync, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000)); //(1 second timeout)
+			glDeleteSync(fence->sync);
+			fence = ring_fences.erase(fence);
+		} else {
+			++fence;
+		}
+	}
+
+	//upload vertices:
+	void *mapped = glMapBufferRange(GL_ARRAY_BUFFER, begin, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (mapped) {
+		std::memcpy(mapped, frame_attribs.data(), size_t(bytes));
+		if (glUnmapBuffer(GL_ARRAY_BUFFER) != GL_TRUE) {
+			//(contents were lost, e.g. to a display mode change -- just re-upload)
+			glBufferSubData(GL_ARRAY_BUFFER, begin, bytes, frame_attribs.data());
+		}
+	} else {
+		glBufferSubData(GL_ARRAY_BUFFER, begin, bytes, frame_attribs.data());
+	}
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	ring_head = end;
 
-	//set color_program as current program:
-	glUseProgram(color_program->program);
+	//upload box instances (small -- 64 bytes per box -- so just orphan and refill):
+	if (!frame_box_texels.empty()) {
+		glBindBuffer(GL_TEXTURE_BUFFER, box_buffer);
+		glBufferData(GL_TEXTURE_BUFFER, frame_box_texels.size() * sizeof(glm::vec4), frame_box_texels.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	GLint base = GLint(begin / GLintptr(sizeof(Vertex)));
+	bool depth_test_was = (glIsEnabled(GL_DEPTH_TEST) == GL_TRUE);
 
-	//upload OBJECT_TO_CLIP to the proper uniform location:
-	glUniformMatrix4fv(color_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+	std::optional< GPUTimer > timer;
+	char const *timed_pass = nullptr;
+	for (auto const &batch : frame_batches) {
+		if (!timer || batch.gpu_pass != timed_pass) {
+			timer.reset(); //(ends the previous pass first)
+			timer.emplace(batch.gpu_pass);
+			timed_pass = batch.gpu_pass;
+		}
 
-	//use the mapping vertex_buffer_for_color_program to fetch vertex data:
-	glBindVertexArray(vertex_buffer_for_color_program);
+		if (batch.depth_test) glEnable(GL_DEPTH_TEST);
+		else glDisable(GL_DEPTH_TEST);
+
+		if (batch.count > 0) {
+			//set color_program as current program:
+			glUseProgram(color_program->program);
+
+			//use the mapping vertex_buffer_for_color_program to fetch vertex data:
+			glBindVertexArray(vertex_buffer_for_color_program);
+
+			//upload OBJECT_TO_CLIP to the proper uniform location:
+			glUniformMatrix4fv(color_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(batch.world_to_clip));
+
+			if (batch.with_bg) {
+				//run the OpenGL pipeline (triangles):
+				glDrawArrays(GL_TRIANGLES, base + batch.first, GLsizei(6));
+			}
 
-	if (with_bg){
-		//run the OpenGL pipeline (triangles):
-		glDrawArrays(GL_TRIANGLES, 0, GLsizei(6));
+			//run the OpenGL pipeline:
+			glDrawArrays(GL_LINES, base + batch.first, batch.count);
+		}
+
+		if (batch.box_count > 0) {
+			//twelve edges per box, expanded from gl_VertexID by box_program:
+			glUseProgram(color_program->box_program);
+			glBindVertexArray(empty_vao);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_BUFFER, box_texture);
+
+			glUniformMatrix4fv(color_program->box_OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(batch.world_to_clip));
+			glUniform1i(color_program->box_INSTANCE_BASE_int, batch.first_box);
+
+			glDrawArraysInstanced(GL_LINES, 0, 24, batch.box_count);
+
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+		}
 	}
 
-	//run the OpenGL pipeline:
-	glDrawArrays(GL_LINES, 0, GLsizei(attribs.size()));
+	timer.reset();
+
+	//mark this range as in use until the draws above are done:
+	ring_fences.emplace_back(RingFence{glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), begin, end});
 
 	//reset vertex array to none:
 	glBindVertexArray(0);
 
 	//reset current program to none:
 	glUseProgram(0);
-}
 
+	if (depth_test_was) glEnable(GL_DEPTH_TEST);
+	else glDisable(GL_DEPTH_TEST);
 
+	frame_attribs.clear();
+	frame_box_texels.clear();
+	frame_batches.clear();
+
+	GL_ERRORS();
+}
@@ -6,6 +6,9 @@
  *
  * Similar usage pattern to DrawSprites.
  *
+ * Lines are batched: each DrawLines adds its vertices to a per-frame list when it is destroyed,
+ * and DrawLines::flush() streams the whole frame's worth to the GPU at once.
+ *
  */
 
 
@@ -22,6 +25,7 @@ struct DrawLines {
 	void draw(glm::vec3 const &a, glm::vec3 const &b, glm::u8vec4 const &color = glm::u8vec4(0xff));
 
 	//draw a wireframe box corresponding to the [-1,1]^3 cube transformed by mat:
+	// (boxes are instanced: only mat and color are uploaded, and the cube's edges are made in the vertex shader)
 	void draw_box(glm::mat4x3 const &mat, glm::u8vec4 const &color = glm::u8vec4(0xff));
 
 	//draw wireframe text, start at anchor, move in x direction, mat gives x and y directions for text drawing:
@@ -33,11 +37,20 @@ struct DrawLines {
 		glm::u8vec4 const &color = glm::u8vec4(0xff),
 		glm::vec3 *anchor_out = nullptr);
 
-	//Finish drawing (push attribs to GPU):
+	//Finish drawing (queue attribs to be drawn by the next flush()):
 	~DrawLines();
 
+	//Draw every DrawLines finished since the last flush, with a single upload for all of them:
+	// (in the order they were finished, each with the depth test state that was current when it was)
+	// main calls this after Mode::draw(), so lines always end up over the rest of the frame
+	static void flush();
+
 	bool with_bg = false;
 
+	//GPUTimer pass that flush() counts these lines as part of:
+	// (consecutive DrawLines with the same pass are timed together)
+	char const *gpu_pass = "lines";
+
 	glm::mat4 world_to_clip;
 	struct Vertex {
 		Vertex(glm::vec3 const &Position_, glm::u8vec4 const &Color_) : Position(Position_), Color(Color_) { }
@@ -45,5 +58,6 @@ struct DrawLines {
 		glm::u8vec4 Color;
 	};
 	std::vector< Vertex > attribs;
+	std::vector< glm::vec4 > box_texels; //four per box: rows of its mat4x3, then its color (for ColorProgram::box_program)
 
 };
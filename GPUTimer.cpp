@@ -0,0 +1,129 @@
+#include "GPUTimer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+
+bool GPUTimer::enabled = false;
+
+namespace {
+	struct Pass {
+		char const *name;
+		std::vector< float > samples; //ring of the last Window times (ms)
+		uint32_t next = 0; //next sample to overwrite, once the ring is full
+	};
+	std::vector< Pass > passes;
+
+	struct Pending {
+		GLuint query;
+		uint32_t pass;
+		uint64_t frame;
+	};
+	std::deque< Pending > pending; //in issue order, which is also the order they finish in
+	std::vector< GLuint > free_queries;
+
+	uint64_t frame = 0;
+	bool timing = false; //a GL_TIME_ELAPSED query is active
+
+	//after this many frames, wait for results instead of letting queries pile up:
+	constexpr uint64_t MaxLatency = 6;
+
+	std::ofstream csv;
+
+	uint32_t find_pass(char const *name) {
+		for (uint32_t i = 0; i < passes.size(); ++i) {
+			if (passes[i].name == name || std::strcmp(passes[i].name, name) == 0) return i;
+		}
+		passes.emplace_back();
+		passes.back().name = name;
+		passes.back().samples.reserve(GPUTimer::Window);
+		return uint32_t(passes.size() - 1);
+	}
+}
+
+GPUTimer::GPUTimer(char const *pass) {
+	if (!enabled || timing) return;
+	if (free_queries.empty()) {
+		free_queries.emplace_back(0);
+		glGenQueries(1, &free_queries.back());
+	}
+	query = free_queries.back();
+	free_queries.pop_back();
+
+	pending.emplace_back(Pending{query, find_pass(pass), frame});
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	timing = true;
+}
+
+GPUTimer::~GPUTimer() {
+	if (query == 0) return;
+	glEndQuery(GL_TIME_ELAPSED);
+	timing = false;
+}
+
+void GPUTimer::end_frame() {
+	assert(!timing && "GPUTimer shouldn't be alive across end_frame()");
+	frame += 1;
+
+	while (!pending.empty()) {
+		Pending const &p = pending.front();
+		if (frame - p.frame < MaxLatency) {
+			//only take results that are ready:
+			GLint available = GL_FALSE;
+			glGetQueryObjectiv(p.query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available != GL_TRUE) break;
+		}
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(p.query, GL_QUERY_RESULT, &ns);
+		float ms = float(ns) / 1.0e6f;
+
+		Pass &pass = passes[p.pass];
+		if (pass.samples.size() < Window) {
+			pass.samples.emplace_back(ms);
+		} else {
+			pass.samples[pass.next] = ms;
+			pass.next = (pass.next + 1) % Window;
+		}
+		if (csv.is_open()) {
+			csv << p.frame << ',' << pass.name << ',' << ms << '\n';
+		}
+
+		free_queries.emplace_back(p.query);
+		pending.pop_front();
+	}
+}
+
+std::vector< GPUTimer::PassStats > GPUTimer::stats() {
+	std::vector< PassStats > ret;
+	std::vector< float > sorted;
+	for (auto const &pass : passes) {
+		if (pass.samples.empty()) continue;
+		sorted = pass.samples;
+		std::sort(sorted.begin(), sorted.end());
+		float total = 0.0f;
+		for (float ms : sorted) total += ms;
+		PassStats s;
+		s.pass = pass.name;
+		s.samples = uint32_t(sorted.size());
+		s.min_ms = sorted.front();
+		s.avg_ms = total / float(sorted.size());
+		s.p99_ms = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+		ret.emplace_back(s);
+	}
+	return ret;
+}
+
+void GPUTimer::log_csv(std::string const &filename) {
+	if (csv.is_open()) csv.close();
+	if (filename.empty()) return;
+	csv.open(filename, std::ios::binary);
+	if (!csv) {
+		std::cerr << "Failed to open '" << filename << "' for GPU timings." << std::endl;
+		return;
+	}
+	csv << "frame,pass,ms\n";
+	std::cout << "Logging GPU pass times to '" << filename << "'." << std::endl;
+}
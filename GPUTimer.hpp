@@ -0,0 +1,59 @@
+#pragma once
+
+/*
+ * GPUTimer -- measures how long the GPU spends on a pass of the frame,
+ * with GL_TIME_ELAPSED queries:
+ *
+ * GPUTimer::enabled = true;
+ *
+ * { //in draw():
+ *     GPUTimer timer("scene");
+ *     scene.draw(*camera);
+ * }
+ *
+ * //once per frame, after swapping:
+ * GPUTimer::end_frame();
+ *
+ * //rolling statistics for each pass:
+ * for (auto const &s : GPUTimer::stats()) { ... s.avg_ms ... }
+ *
+ * Results are read back a few frames later, once the GPU has caught up, so timing never stalls the pipeline.
+ * Passes can't nest (the GL only allows one GL_TIME_ELAPSED query at a time); nested timers are ignored.
+ *
+ */
+
+#include "GL.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct GPUTimer {
+	//time GL commands issued from construction to destruction as part of 'pass':
+	// (pass must stay valid -- in practice, a string literal)
+	GPUTimer(char const *pass);
+	~GPUTimer();
+	GPUTimer(GPUTimer const &) = delete;
+	GPUTimer &operator=(GPUTimer const &) = delete;
+
+	//timers do nothing unless enabled:
+	static bool enabled;
+
+	//collect finished queries (call once per frame, after swapping):
+	static void end_frame();
+
+	//min/average/99th percentile over (up to) the last Window samples of each pass:
+	struct PassStats {
+		char const *pass;
+		float min_ms, avg_ms, p99_ms;
+		uint32_t samples;
+	};
+	static std::vector< PassStats > stats();
+	static constexpr uint32_t Window = 240;
+
+	//also append each collected time to a CSV file ("frame,pass,ms"), or stop if filename is empty:
+	static void log_csv(std::string const &filename);
+
+	//-- internals ---
+	GLuint query = 0; //0 if not timing
+};
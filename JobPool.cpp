@@ -0,0 +1,124 @@
+#include "JobPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+JobPool::JobPool(uint32_t workers_) {
+	for (uint32_t i = 0; i < workers_ + 1; ++i) {
+		queues.emplace_back(std::make_unique< Queue >());
+	}
+	for (uint32_t i = 0; i < workers_; ++i) {
+		workers.emplace_back(&JobPool::worker_main, this, i + 1);
+	}
+}
+
+JobPool::~JobPool() {
+	{
+		std::unique_lock< std::mutex > lock(wake_mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (auto &w : workers) {
+		w.join();
+	}
+}
+
+uint32_t JobPool::default_workers() {
+	uint32_t hardware = std::thread::hardware_concurrency();
+	//hardware_concurrency may return zero if it can't tell:
+	return (hardware > 1 ? hardware - 1 : 0);
+}
+
+void JobPool::parallel_for(size_t count, size_t grain, std::function< void(size_t, size_t) > const &fn) {
+	if (count == 0) return;
+	grain = std::max< size_t >(grain, 1);
+
+	//not worth waking anyone up for a single chunk:
+	if (workers.empty() || count <= grain) {
+		for (size_t begin = 0; begin < count; begin += grain) {
+			fn(begin, std::min(count, begin + grain));
+		}
+		return;
+	}
+
+	size_t chunks = (count + grain - 1) / grain;
+	assert(remaining == 0 && "parallel_for should not be called re-entrantly");
+	remaining = chunks;
+
+	//deal chunks out to the queues in contiguous runs, so each thread starts with neighbouring items:
+	uint32_t threads = uint32_t(queues.size());
+	for (uint32_t q = 0; q < threads; ++q) {
+		size_t first = chunks * q / threads;
+		size_t last = chunks * (q + 1) / threads;
+		std::unique_lock< std::mutex > lock(queues[q]->mutex);
+		for (size_t c = first; c < last; ++c) {
+			Chunk chunk;
+			chunk.fn = &fn;
+			chunk.begin = c * grain;
+			chunk.end = std::min(count, chunk.begin + grain);
+			queues[q]->chunks.emplace_back(chunk);
+		}
+	}
+	{
+		std::unique_lock< std::mutex > lock(wake_mutex);
+		generation += 1;
+	}
+	wake.notify_all();
+
+	//help out until everything is done:
+	Chunk chunk;
+	while (remaining.load(std::memory_order_acquire) != 0) {
+		if (take(0, &chunk)) {
+			run(chunk);
+		} else {
+			//the last few chunks are running elsewhere:
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool JobPool::take(uint32_t self, Chunk *chunk) {
+	assert(chunk);
+	{ //own queue, newest first:
+		Queue &queue = *queues[self];
+		std::unique_lock< std::mutex > lock(queue.mutex);
+		if (!queue.chunks.empty()) {
+			*chunk = queue.chunks.back();
+			queue.chunks.pop_back();
+			return true;
+		}
+	}
+	//steal from everyone else, oldest first:
+	uint32_t threads = uint32_t(queues.size());
+	for (uint32_t offset = 1; offset < threads; ++offset) {
+		Queue &queue = *queues[(self + offset) % threads];
+		std::unique_lock< std::mutex > lock(queue.mutex);
+		if (!queue.chunks.empty()) {
+			*chunk = queue.chunks.front();
+			queue.chunks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobPool::run(Chunk const &chunk) {
+	(*chunk.fn)(chunk.begin, chunk.end);
+	remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobPool::worker_main(uint32_t self) {
+	uint64_t seen = 0;
+	while (true) {
+		{ //sleep until there is something new to do:
+			std::unique_lock< std::mutex > lock(wake_mutex);
+			wake.wait(lock, [&](){ return quit || generation != seen; });
+			if (quit) return;
+			seen = generation;
+		}
+		Chunk chunk;
+		while (take(self, &chunk)) {
+			run(chunk);
+		}
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+/*
+ * JobPool is a small work-stealing thread pool for data-parallel loops.
+ *
+ * //at setup:
+ * JobPool jobs(JobPool::default_workers());
+ *
+ * //later, split [0,count) into chunks of 'grain' items and run them across all threads:
+ * jobs.parallel_for(count, 64, [&](size_t begin, size_t end){
+ *     for (size_t i = begin; i < end; ++i) { ... }
+ * });
+ *
+ * Each thread (workers + the calling thread) owns a queue of chunks; threads take work
+ * from the back of their own queue and steal from the front of the others' when empty.
+ * parallel_for returns once every chunk has run, so anything written by the chunks is
+ * visible to the caller afterwards.
+ *
+ * Chunk boundaries only depend on 'count' and 'grain', so if each chunk only writes its
+ * own items, results are identical no matter how many threads run them.
+ *
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct JobPool {
+	//spin up 'workers' threads (0 means parallel_for just runs everything on the calling thread):
+	JobPool(uint32_t workers);
+	~JobPool();
+
+	JobPool(JobPool const &) = delete;
+	JobPool &operator=(JobPool const &) = delete;
+
+	//one worker per hardware thread, not counting the calling thread:
+	static uint32_t default_workers();
+
+	//run fn(begin, end) over [0,count) in chunks of at most 'grain' items; blocks until all are done:
+	// (only call from one thread at a time)
+	void parallel_for(size_t count, size_t grain, std::function< void(size_t, size_t) > const &fn);
+
+	//number of threads that run chunks (workers + caller):
+	uint32_t threads() const { return uint32_t(queues.size()); }
+
+	//-- internals ---
+
+	struct Chunk {
+		std::function< void(size_t, size_t) > const *fn = nullptr;
+		size_t begin = 0;
+		size_t end = 0;
+	};
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque< Chunk > chunks;
+	};
+
+	//take a chunk from queue 'self' (back) or steal one from any other queue (front):
+	bool take(uint32_t self, Chunk *chunk);
+	void run(Chunk const &chunk);
+	void worker_main(uint32_t self);
+
+	//queues[0] belongs to the calling thread, queues[1+i] to workers[i]:
+	std::vector< std::unique_ptr< Queue > > queues;
+	std::vector< std::thread > workers;
+
+	std::atomic< size_t > remaining{0}; //chunks of the current parallel_for not yet finished
+	std::mutex wake_mutex;
+	std::condition_variable wake; //signaled when new chunks are queued (or on shutdown)
+	uint64_t generation = 0; //incremented under wake_mutex every time chunks are queued
+	bool quit = false;
+};
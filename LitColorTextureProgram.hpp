@@ -31,6 +31,24 @@ struct LitColorTextureProgram {
 	
 	//Textures:
 	//TEXTURE0 - texture that is accessed by TexCoord
+
+	//Instanced version (same attributes, lighting uniforms, and fragment shader):
+	GLuint instanced_program = 0;
+
+	GLuint instanced_WORLD_TO_CLIP_mat4 = -1U;
+	GLuint instanced_WORLD_TO_LIGHT_mat4x3 = -1U;
+	GLuint instanced_NORMAL_WORLD_TO_LIGHT_mat3 = -1U;
+	GLuint instanced_INSTANCE_BASE_int = -1U;
+
+	GLuint instanced_LIGHT_TYPE_int = -1U;
+	GLuint instanced_LIGHT_LOCATION_vec3 = -1U;
+	GLuint instanced_LIGHT_DIRECTION_vec3 = -1U;
+	GLuint instanced_LIGHT_ENERGY_vec3 = -1U;
+	GLuint instanced_LIGHT_CUTOFF_float = -1U;
+
+	//Textures:
+	//TEXTURE0 - texture that is accessed by TexCoord
+	//TEXTURE4 (Scene::Drawable::Pipeline::InstanceTextureUnit) - per-instance transforms (buffer texture)
 };
 
 extern Load< LitColorTextureProgram > lit_color_texture_program;
@@ -3,18 +3,31 @@
 #include <array>
 #include <list>
 #include <cassert>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <mutex>
 
 namespace {
-	std::array< std::list< std::function< void() > >, MaxLoadTag > &get_load_lists() {
-		static std::array< std::list< std::function< void() > >, MaxLoadTag > load_lists;
+	struct LoadFunction {
+		std::function< void() > background; //may be empty
+		std::function< void() > foreground; //may be empty
+	};
+
+	std::array< std::list< LoadFunction >, MaxLoadTag > &get_load_lists() {
+		static std::array< std::list< LoadFunction >, MaxLoadTag > load_lists;
 		return load_lists;
 	}
 }
 
 void add_load_function(LoadTag tag, std::function< void() > const &fn) {
+	add_load_function(tag, std::function< void() >(), fn);
+}
+
+void add_load_function(LoadTag tag, std::function< void() > const &background, std::function< void() > const &foreground) {
 	auto &load_lists = get_load_lists();
 	assert(tag < load_lists.size());
-	load_lists[tag].emplace_back(fn);
+	load_lists[tag].emplace_back(LoadFunction{background, foreground});
 }
 
 void call_load_functions() {
@@ -23,10 +36,56 @@ void call_load_functions() {
 	has_been_called = true;
 
 	auto &load_lists = get_load_lists();
-	for (auto &fn_list : load_lists) {
-		while (!fn_list.empty()) {
-			(*fn_list.begin())(); //call first function in the list
-			fn_list.pop_front(); //remove from list
+
+	//background phases of tag t wait until every function of tags < t has completely finished:
+	std::mutex mutex;
+	std::condition_variable cv;
+	uint32_t finished_tags = 0;
+	bool abandoned = false; //set if a load failed, so waiting work gives up
+
+	//start all background phases right away (each on its own thread; there are only a handful):
+	std::array< std::list< std::future< void > >, MaxLoadTag > prepared;
+	for (uint32_t tag = 0; tag < MaxLoadTag; ++tag) {
+		for (auto &fn : load_lists[tag]) {
+			if (!fn.background) {
+				prepared[tag].emplace_back();
+				continue;
+			}
+			prepared[tag].emplace_back(std::async(std::launch::async, [&,tag,background=fn.background](){
+				{
+					std::unique_lock< std::mutex > lock(mutex);
+					cv.wait(lock, [&](){ return finished_tags >= tag || abandoned; });
+					if (abandoned) return;
+				}
+				background();
+			}));
+		}
+	}
+
+	//on the context thread, finish functions in order as their background phases complete:
+	try {
+		for (uint32_t tag = 0; tag < MaxLoadTag; ++tag) {
+			auto &fn_list = load_lists[tag];
+			auto &future_list = prepared[tag];
+			while (!fn_list.empty()) {
+				if (future_list.front().valid()) future_list.front().get(); //wait (rethrows background exceptions)
+				if (fn_list.front().foreground) fn_list.front().foreground();
+				fn_list.pop_front(); //remove from list
+				future_list.pop_front();
+			}
+			{
+				std::unique_lock< std::mutex > lock(mutex);
+				finished_tags = tag + 1;
+			}
+			cv.notify_all();
+		}
+	} catch (...) {
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			abandoned = true;
 		}
+		cv.notify_all();
+		//n.b. futures left in 'prepared' wait for their (running or abandoned) threads when destroyed
+		throw;
 	}
 }
@@ -20,9 +20,24 @@
  * These functions are grouped by 'tags', which allow some sequencing of calls.
  * (particularly, this is useful for loading large data blobs [e.g. Meshes] before looking up individual elements within them.)
  *
+ * Loads can also be split into two phases, so that file reading and parsing happens in parallel:
+ *
+ * Load< MeshBuffer > meshes(LoadTagDefault, []() -> MeshBuffer * {
+ *     return new MeshBuffer(data_path("world.pnct"), MeshBuffer::VertexFormat::Full, MeshBuffer::DeferUpload); //worker thread: no OpenGL!
+ * }, [](MeshBuffer &buffer) {
+ *     buffer.upload(); //OpenGL context thread
+ * });
+ *
+ * Ordering guarantees (the same ones the old, serial loader gave):
+ *  - everything in earlier tags is completely loaded before any function of a later tag starts (either phase);
+ *  - second phases (and single-phase functions) run on the context thread, in the order they were added;
+ *  - first phases of the same tag run concurrently, so they must not depend on each other.
+ *
  */
 
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <stdexcept>
 
 enum LoadTag : uint32_t {
@@ -36,9 +51,14 @@ enum LoadTag : uint32_t {
 // (only call *before* "call_load_functions()")
 void add_load_function(LoadTag tag, std::function< void() > const &fn);
 
+//Add a two-phase loading function:
+// 'background' runs on a worker thread (file I/O, parsing -- no OpenGL calls!),
+// 'foreground' runs afterward on the thread that calls call_load_functions() (e.g., GL uploads).
+void add_load_function(LoadTag tag, std::function< void() > const &background, std::function< void() > const &foreground);
+
 //Call all loading functions:
-// (loading functions may throw exceptions if they fail.)
-// (only call *once*)
+// (loading functions may throw exceptions if they fail; the first one thrown is rethrown here.)
+// (only call *once*, from the thread with the OpenGL context)
 void call_load_functions();
 
 
@@ -51,13 +71,34 @@ struct Load {
 	//Constructing a Load< T > adds the passed function to the list of functions to call:
 	Load(LoadTag tag, const std::function< T const *() > &load_fn = new_T< T >) : value(nullptr) {
 		add_load_function(tag, [this,load_fn](){
-			this->value = load_fn();
-			if (!(this->value)) {
+			T const *loaded = load_fn();
+			if (!loaded) {
 				throw std::runtime_error("Loading failed.");
 			}
+			this->value = loaded;
+			this->loaded = true;
 		});
 	}
 
+	//Two-phase version: 'background_fn' builds the T on a worker thread (no OpenGL calls!),
+	// 'finish_fn' completes it on the context thread (e.g., uploads to the GPU) before it becomes ready:
+	Load(LoadTag tag, const std::function< T *() > &background_fn, const std::function< void(T &) > &finish_fn) : value(nullptr) {
+		auto prepared = std::make_shared< T * >(nullptr);
+		add_load_function(tag, [prepared,background_fn](){
+			*prepared = background_fn();
+			if (!*prepared) {
+				throw std::runtime_error("Loading failed.");
+			}
+		}, [this,prepared,finish_fn](){
+			finish_fn(**prepared);
+			this->value = *prepared;
+			this->loaded = true;
+		});
+	}
+
+	//true once the value is completely loaded (safe to check from any thread):
+	bool ready() const { return loaded; }
+
 	//Make a "Load< T >" behave like a "T const *":
 	explicit operator bool() { return value != nullptr; }
 	operator T const *() { return value; }
@@ -65,6 +106,7 @@ struct Load {
 	T const *operator->() { return value; }
 
 	T const *value;
+	std::atomic< bool > loaded{false};
 };
 
 
@@ -74,8 +116,15 @@ template< >
 struct Load< void > {
 	//Constructing a Load< T > adds the passed function to the list of functions to call:
 	Load( LoadTag tag, const std::function< void() > &load_fn) {
-		add_load_function(tag, load_fn);
+		add_load_function(tag, [this,load_fn](){
+			load_fn();
+			this->loaded = true;
+		});
 	}
+
+	bool ready() const { return loaded; }
+
+	std::atomic< bool > loaded{false};
 };
 
 
@@ -100,6 +100,11 @@ if (maek.OS === 'windows') {
 // cppFile: name of c++ file to compile
 // objFileBase (optional): base name object file to produce (if not supplied, set to options.objDir + '/' + cppFile without the extension)
 //returns objFile: objFileBase + a platform-dependant suffix ('.o' or '.obj')
+const vehicle_names = [
+	maek.CPP('VehicleSystem.cpp'),
+	maek.CPP('JobPool.cpp')
+];
+
 const game_names = [
 	maek.CPP('PlayMode.cpp'),
 	maek.CPP('main.cpp'),
@@ -115,11 +120,26 @@ const common_names = [
 	maek.CPP('ColorProgram.cpp'),
 	maek.CPP('Scene.cpp'),
 	maek.CPP('Mesh.cpp'),
+	maek.CPP('MappedFile.cpp'),
 	maek.CPP('load_save_png.cpp'),
 	maek.CPP('gl_compile_program.cpp'),
 	maek.CPP('Mode.cpp'),
 	maek.CPP('GL.cpp'),
-	maek.CPP('Load.cpp')
+	maek.CPP('Load.cpp'),
+	maek.CPP('Profiler.cpp'),
+	maek.CPP('GPUTimer.cpp')
+];
+
+const sim_names = [
+	maek.CPP('bonk-sim.cpp')
+];
+
+const bench_names = [
+	maek.CPP('bench.cpp')
+];
+
+const bake_names = [
+	maek.CPP('bake-vehicles.cpp')
 ];
 
 const show_mesh_names = [
@@ -138,12 +158,23 @@ const show_scene_names = [
 // objFiles: array of objects to link
 // exeFileBase: name of executable file to produce
 //returns exeFile: exeFileBase + a platform-dependant suffix (e.g., '.exe' on windows)
-const game_exe = maek.LINK([...game_names, ...common_names], 'dist/game');
+const game_exe = maek.LINK([...game_names, ...vehicle_names, ...common_names], 'dist/game');
+const sim_exe = maek.LINK([...sim_names, ...vehicle_names, ...common_names], 'dist/bonk-sim');
+const bench_exe = maek.LINK([...bench_names, ...vehicle_names, ...common_names], 'dist/bench');
+const bake_exe = maek.LINK([...bake_names, ...vehicle_names, ...common_names], 'scenes/bake-vehicles');
 const show_meshes_exe = maek.LINK([...show_mesh_names, ...common_names], 'scenes/show-meshes');
 const show_scene_exe = maek.LINK([...show_scene_names, ...common_names], 'scenes/show-scene');
 
+//pre-resolve the vehicles in world.scene for the game (re-run whenever the scene, meshes, or baker change):
+// (world.pnct is exported from blender by scenes/Makefile, so this is only a default target once it exists)
+const vehicles_cache = 'dist/world.vehicles';
+maek.RULE([vehicles_cache], [bake_exe, 'dist/world.scene', 'dist/world.pnct'], [
+	[bake_exe, 'dist/world.scene', 'dist/world.pnct', vehicles_cache]
+]);
+const bakes = require('fs').existsSync('dist/world.pnct') ? [vehicles_cache] : [];
+
 //set the default target to the game (and copy the readme files):
-maek.TARGETS = [game_exe, show_meshes_exe, show_scene_exe, ...copies];
+maek.TARGETS = [game_exe, sim_exe, bench_exe, bake_exe, ...bakes, show_meshes_exe, show_scene_exe, ...copies];
 
 //the '[targets =] RULE(targets, prerequisites[, recipe])' rule defines a Makefile-style task
 // targets: array of targets the task produces (can include both files and ':abstract targets')
@@ -154,6 +185,21 @@ maek.RULE([':run'], [game_exe], [
 	[game_exe, '--some-command-line-option']
 ]);
 
+//headless simulation benchmark / soak test:
+maek.RULE([':sim'], [sim_exe], [
+	[sim_exe]
+]);
+
+//microbenchmarks (results also go to bench.json, to compare against other revisions):
+maek.RULE([':bench'], [bench_exe], [
+	[bench_exe, '--json', 'bench.json']
+]);
+
+//force a re-bake of the vehicle cache (the default build only keeps it up to date when dist/world.pnct exists):
+maek.RULE([':bake'], [bake_exe], [
+	[bake_exe, 'dist/world.scene', 'dist/world.pnct', vehicles_cache]
+]);
+
 //Note that tasks that produce ':abstract targets' are never cached.
 // This is similar to how .PHONY targets behave in make.
 
@@ -0,0 +1,140 @@
+#pragma once
+
+/*
+ * MappedFile maps a whole file read-only into memory, and
+ * ChunkReader walks the same chunk format as read_chunk (see read_write_chunk.hpp)
+ * directly over that mapping, handing out typed views of each chunk instead of copies:
+ *
+ * MappedFile file(data_path("world.pnct")); //throws if the file can't be opened/mapped
+ * ChunkReader chunks(file);
+ * ChunkSpan< Vertex > vertices = chunks.read_chunk< Vertex >("pnct"); //throws on format errors
+ * glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+ *
+ * Spans point into the mapping, so they are only valid while the MappedFile is alive.
+ *
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+struct MappedFile {
+	//map 'filename' (throws on failure):
+	MappedFile(std::string const &filename);
+	~MappedFile();
+
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+
+	std::string filename;
+	char const *data = nullptr; //nullptr for empty files
+	size_t size = 0;
+
+	//-- internals ---
+#ifdef _WIN32
+	void *file_handle = nullptr;
+	void *mapping_handle = nullptr;
+#endif
+};
+
+//read-only view of an array of T inside a mapped chunk:
+template< typename T >
+struct ChunkSpan {
+	ChunkSpan() = default;
+
+	T const *data() const { return data_; }
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	T const &operator[](size_t i) const { assert(i < size_); return data_[i]; }
+	T const *begin() const { return data_; }
+	T const *end() const { return data_ + size_; }
+
+	//chunks are only 4-byte aligned relative to each other (e.g., after an odd-sized "str0" chunk),
+	// so when the data in the file isn't suitably aligned for T, the span points at this copy instead:
+	ChunkSpan(ChunkSpan &&) = default;
+	ChunkSpan &operator=(ChunkSpan &&) = default;
+	ChunkSpan(ChunkSpan const &) = delete;
+	ChunkSpan &operator=(ChunkSpan const &) = delete;
+
+	T const *data_ = nullptr;
+	size_t size_ = 0;
+	std::vector< T > unaligned_copy;
+};
+
+//walks the chunks of a mapped file in order:
+struct ChunkReader {
+	ChunkReader(MappedFile const &file_) : file(file_) { }
+
+	//read the next chunk, which must have the given magic number (throws on format errors, like read_chunk):
+	template< typename T >
+	ChunkSpan< T > read_chunk(std::string const &magic);
+
+	//magic number of the next chunk (or "" if there isn't one), for files with optional chunks:
+	std::string peek_magic() const {
+		if (remaining() < 8) return "";
+		return std::string(position(), 4);
+	}
+
+	//bytes not yet consumed:
+	char const *position() const { return file.data + offset; }
+	size_t remaining() const { return file.size - offset; }
+
+	MappedFile const &file;
+	size_t offset = 0;
+};
+
+//std::istream over a range of memory (e.g., the unread part of a mapped file), for code that wants a stream:
+struct MemoryStreamBuf : std::streambuf {
+	MemoryStreamBuf(char const *begin, size_t size) {
+		char *b = const_cast< char * >(begin); //n.b. get area is never written through
+		setg(b, b, b + size);
+	}
+};
+struct MemoryStream : std::istream {
+	MemoryStream(char const *begin, size_t size) : std::istream(nullptr), buf(begin, size) { rdbuf(&buf); }
+	MemoryStreamBuf buf;
+};
+
+
+template< typename T >
+ChunkSpan< T > ChunkReader::read_chunk(std::string const &magic) {
+	struct ChunkHeader {
+		char magic[4] = {'\0', '\0', '\0', '\0'};
+		uint32_t size = 0;
+	};
+	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+	ChunkHeader header;
+	if (remaining() < sizeof(header)) {
+		throw std::runtime_error("Failed to read chunk header");
+	}
+	std::memcpy(&header, position(), sizeof(header));
+	if (std::string(header.magic,4) != magic) {
+		throw std::runtime_error("Unexpected magic number in chunk");
+	}
+	offset += sizeof(header);
+
+	if (header.size % sizeof(T) != 0) {
+		throw std::runtime_error("Size of chunk not divisible by element size");
+	}
+	if (remaining() < header.size) {
+		throw std::runtime_error("Failed to read chunk data.");
+	}
+
+	ChunkSpan< T > span;
+	span.size_ = header.size / sizeof(T);
+	if (reinterpret_cast< uintptr_t >(position()) % alignof(T) == 0) {
+		span.data_ = reinterpret_cast< T const * >(position());
+	} else {
+		span.unaligned_copy.resize(span.size_);
+		if (header.size) std::memcpy(span.unaligned_copy.data(), position(), header.size);
+		span.data_ = span.unaligned_copy.data();
+	}
+	offset += header.size;
+	return span;
+}
@@ -1,20 +1,24 @@
 #include "Mesh.hpp"
-#include "read_write_chunk.hpp"
+#include "MappedFile.hpp"
 
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include <stdexcept>
-#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <set>
 #include <cstddef>
+#include <cstring>
+#include <cassert>
 
-MeshBuffer::MeshBuffer(std::string const &filename) {
-	glGenBuffers(1, &buffer);
-
-	std::ifstream file(filename, std::ios::binary);
+MeshBuffer::MeshBuffer(std::string const &filename, VertexFormat format, UploadMode upload_mode) {
+	//read chunks straight out of the mapped file (no intermediate copies):
+	// (the mapping stays open until upload(), which reads vertices and indices from it)
+	pending.reset(new PendingUpload);
+	pending->file.reset(new MappedFile(filename));
+	ChunkReader chunks(*pending->file);
 
 	GLuint total = 0;
 
@@ -25,40 +29,82 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		glm::vec2 TexCoord;
 	};
 	static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
-	std::vector< Vertex > data;
+	ChunkSpan< Vertex > data;
 
-	//read + upload data chunk:
+	//read data chunk (uploaded below, once the per-mesh bounds are known):
 	if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".pnct") {
-		read_chunk(file, "pnct", &data);
-
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, buffer);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		data = chunks.read_chunk< Vertex >("pnct");
 
 		total = GLuint(data.size()); //store total for later checks on index
-
-		//store attrib locations:
-		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
-		Normal = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Normal));
-		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
-		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
 	} else {
 		throw std::runtime_error("Unknown file type '" + filename + "'");
 	}
 
-	std::vector< char > strings;
-	read_chunk(file, "str0", &strings);
+	//(optional) indices for indexed meshes, written by export-meshes.py as 16-bit if every mesh has few enough vertices:
+	ChunkSpan< uint16_t > indices16;
+	ChunkSpan< uint32_t > indices32;
+	GLenum index_type = 0;
+	GLuint index_total = 0;
+	if (chunks.peek_magic() == "ix16") {
+		indices16 = chunks.read_chunk< uint16_t >("ix16");
+		index_type = GL_UNSIGNED_SHORT;
+		index_total = GLuint(indices16.size());
+	} else if (chunks.peek_magic() == "ix32") {
+		indices32 = chunks.read_chunk< uint32_t >("ix32");
+		index_type = GL_UNSIGNED_INT;
+		index_total = GLuint(indices32.size());
+	}
+	auto index_at = [&](uint32_t i) -> uint32_t {
+		return (index_type == GL_UNSIGNED_SHORT ? uint32_t(indices16[i]) : indices32[i]);
+	};
+
+	//indices are uploaded as-is:
+	// (n.b. a span's unaligned copy goes away with the span, so those are kept in pending's storage)
+	if (index_type == GL_UNSIGNED_SHORT) {
+		pending->index_data = reinterpret_cast< char const * >(indices16.data());
+		pending->index_bytes = indices16.size() * sizeof(uint16_t);
+		if (!indices16.unaligned_copy.empty()) pending->index_storage.assign(pending->index_data, pending->index_data + pending->index_bytes);
+	} else if (index_type == GL_UNSIGNED_INT) {
+		pending->index_data = reinterpret_cast< char const * >(indices32.data());
+		pending->index_bytes = indices32.size() * sizeof(uint32_t);
+		if (!indices32.unaligned_copy.empty()) pending->index_storage.assign(pending->index_data, pending->index_data + pending->index_bytes);
+	}
+	if (!pending->index_storage.empty()) pending->index_data = pending->index_storage.data();
+
+	ChunkSpan< char > strings = chunks.read_chunk< char >("str0");
+
+	//vertex ranges of each mesh, with the mapping used to quantize their positions:
+	struct VertexRange {
+		uint32_t begin, end;
+		glm::vec3 offset, scale;
+	};
+	std::vector< VertexRange > ranges;
+
+	auto add_mesh = [&](uint32_t name_begin, uint32_t name_end, uint32_t vertex_begin, uint32_t vertex_end, Mesh mesh) {
+		if (format == VertexFormat::Compact && vertex_begin < vertex_end) {
+			//map the bounding box to [-1,1]^3 (leaving flat axes alone):
+			mesh.position_offset = 0.5f * (mesh.max + mesh.min);
+			mesh.position_scale = 0.5f * (mesh.max - mesh.min);
+			for (uint32_t c = 0; c < 3; ++c) {
+				if (!(mesh.position_scale[c] > 0.0f)) mesh.position_scale[c] = 1.0f;
+			}
+			ranges.emplace_back(VertexRange{vertex_begin, vertex_end, mesh.position_offset, mesh.position_scale});
+		}
+		std::string name(strings.data() + name_begin, strings.data() + name_end);
+		bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
+		if (!inserted) {
+			std::cerr << "WARNING: mesh name '" + name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
+		}
+	};
 
-	{ //read index chunk, add to meshes:
+	if (index_type == 0) { //read index chunk, add to meshes:
 		struct IndexEntry {
 			uint32_t name_begin, name_end;
 			uint32_t vertex_begin, vertex_end;
 		};
 		static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
 
-		std::vector< IndexEntry > index;
-		read_chunk(file, "idx0", &index);
+		ChunkSpan< IndexEntry > index = chunks.read_chunk< IndexEntry >("idx0");
 
 		for (auto const &entry : index) {
 			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
@@ -67,7 +113,6 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) {
 				throw std::runtime_error("index entry has out-of-range vertex start/count");
 			}
-			std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
 			Mesh mesh;
 			mesh.type = GL_TRIANGLES;
 			mesh.start = entry.vertex_begin;
@@ -76,14 +121,114 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 				mesh.min = glm::min(mesh.min, data[v].Position);
 				mesh.max = glm::max(mesh.max, data[v].Position);
 			}
-			bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
-			if (!inserted) {
-				std::cerr << "WARNING: mesh name '" + name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
+			add_mesh(entry.name_begin, entry.name_end, entry.vertex_begin, entry.vertex_end, mesh);
+		}
+	} else { //read indexed-mesh index chunk, add to meshes:
+		struct IndexedEntry {
+			uint32_t name_begin, name_end;
+			uint32_t vertex_begin, vertex_end; //vertices used by this mesh
+			uint32_t index_begin, index_end; //indices (relative to vertex_begin) of its triangles
+		};
+		static_assert(sizeof(IndexedEntry) == 24, "Indexed entry should be packed");
+
+		ChunkSpan< IndexedEntry > index = chunks.read_chunk< IndexedEntry >("idx1");
+
+		for (auto const &entry : index) {
+			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
+				throw std::runtime_error("index entry has out-of-range name begin/end");
+			}
+			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) {
+				throw std::runtime_error("index entry has out-of-range vertex start/count");
+			}
+			if (!(entry.index_begin <= entry.index_end && entry.index_end <= index_total)) {
+				throw std::runtime_error("index entry has out-of-range index start/count");
+			}
+			uint32_t vertex_count = entry.vertex_end - entry.vertex_begin;
+			for (uint32_t i = entry.index_begin; i < entry.index_end; ++i) {
+				if (index_at(i) >= vertex_count) {
+					throw std::runtime_error("indexed mesh refers to a vertex outside its range");
+				}
+			}
+			Mesh mesh;
+			mesh.type = GL_TRIANGLES;
+			mesh.start = entry.index_begin;
+			mesh.count = entry.index_end - entry.index_begin;
+			mesh.index_type = index_type;
+			mesh.base_vertex = GLint(entry.vertex_begin);
+			for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
+				mesh.min = glm::min(mesh.min, data[v].Position);
+				mesh.max = glm::max(mesh.max, data[v].Position);
+			}
+			add_mesh(entry.name_begin, entry.name_end, entry.vertex_begin, entry.vertex_end, mesh);
+		}
+	}
+
+	//prepare vertex data for upload:
+	if (format == VertexFormat::Full) {
+		pending->vertex_data = reinterpret_cast< char const * >(data.data());
+		pending->vertex_bytes = data.size() * sizeof(Vertex);
+		if (!data.unaligned_copy.empty()) {
+			pending->vertex_storage.assign(pending->vertex_data, pending->vertex_data + pending->vertex_bytes);
+			pending->vertex_data = pending->vertex_storage.data();
+		}
+
+		//store attrib locations:
+		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
+		Normal = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Normal));
+		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
+		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
+	} else {
+		assert(format == VertexFormat::Compact);
+		struct CompactVertex {
+			glm::i16vec3 Position; //snorm16, relative to mesh bounds
+			uint16_t padding;
+			uint32_t Normal; //snorm 10-10-10(-2), as GL_INT_2_10_10_10_REV
+			glm::u8vec4 Color;
+			glm::u16vec2 TexCoord; //half floats
+		};
+		static_assert(sizeof(CompactVertex) == 2*3+2+4+4*1+2*2, "CompactVertex is packed.");
+
+		std::vector< char > &compact = pending->vertex_storage;
+		compact.resize(data.size() * sizeof(CompactVertex));
+		auto quantize = [&](uint32_t v, glm::vec3 const &offset, glm::vec3 const &scale) {
+			Vertex const &in = data[v];
+			CompactVertex out;
+			glm::vec3 p = (in.Position - offset) / scale;
+			//n.b. GL 3.3 and GL 4.2+ map snorm values to floats slightly differently (by half a step at most):
+			out.Position = glm::i16vec3(glm::packSnorm1x16(p.x), glm::packSnorm1x16(p.y), glm::packSnorm1x16(p.z));
+			out.padding = 0;
+			out.Normal = glm::packSnorm3x10_1x2(glm::vec4(in.Normal, 0.0f));
+			out.Color = in.Color;
+			out.TexCoord = glm::u16vec2(glm::packHalf1x16(in.TexCoord.x), glm::packHalf1x16(in.TexCoord.y));
+			std::memcpy(compact.data() + v * sizeof(CompactVertex), &out, sizeof(CompactVertex));
+		};
+		//vertices that no mesh uses are quantized as-is (i.e., clamped to [-1,1]), since they are never drawn:
+		for (uint32_t v = 0; v < data.size(); ++v) {
+			quantize(v, glm::vec3(0.0f), glm::vec3(1.0f));
+		}
+		for (auto const &range : ranges) {
+			for (uint32_t v = range.begin; v < range.end; ++v) {
+				quantize(v, range.offset, range.scale);
 			}
 		}
+
+		pending->vertex_data = compact.data();
+		pending->vertex_bytes = compact.size();
+
+		//store attrib locations:
+		Position = Attrib(3, GL_SHORT, GL_TRUE, sizeof(CompactVertex), offsetof(CompactVertex, Position));
+		Normal = Attrib(4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(CompactVertex), offsetof(CompactVertex, Normal));
+		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(CompactVertex), offsetof(CompactVertex, Color));
+		TexCoord = Attrib(2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactVertex), offsetof(CompactVertex, TexCoord));
+	}
+
+	//index meshes by name for lookup():
+	mesh_index.reserve(meshes.size());
+	for (auto const &m : meshes) {
+		mesh_index.insert(hash_name(m.first), &m);
 	}
 
-	if (file.peek() != EOF) {
+	if (chunks.remaining() != 0) {
 		std::cerr << "WARNING: trailing data in mesh file '" << filename << "'" << std::endl;
 	}
 
@@ -96,17 +241,43 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 	}
 	std::cout << std::endl;
 	*/
+
+	if (upload_mode == UploadNow) upload();
+}
+
+MeshBuffer::~MeshBuffer() {
+	//(defined here, where MappedFile is a complete type)
+}
+
+void MeshBuffer::upload() {
+	if (!pending) throw std::runtime_error("MeshBuffer::upload() called twice.");
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, pending->vertex_bytes, pending->vertex_data, GL_STATIC_DRAW);
+
+	if (pending->index_data) {
+		//upload indices through GL_ARRAY_BUFFER, since GL_ELEMENT_ARRAY_BUFFER bindings belong to whatever vao is bound:
+		glGenBuffers(1, &index_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, index_buffer);
+		glBufferData(GL_ARRAY_BUFFER, pending->index_bytes, pending->index_data, GL_STATIC_DRAW);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	pending.reset(); //unmaps the file
 }
 
 const Mesh &MeshBuffer::lookup(std::string const &name) const {
-	auto f = meshes.find(name);
-	if (f == meshes.end()) {
+	auto f = mesh_index.find(hash_name(name));
+	if (!f || (*f)->first != name) {
 		throw std::runtime_error("Looking up mesh '" + name + "' that doesn't exist.");
 	}
-	return f->second;
+	return (*f)->second;
 }
 
 GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
+	if (pending) throw std::runtime_error("MeshBuffer::make_vao_for_program() called before upload().");
+
 	//create a new vertex array object:
 	GLuint vao = 0;
 	glGenVertexArrays(1, &vao);
@@ -128,6 +299,10 @@ GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
 	bind_attribute("Color", Color);
 	bind_attribute("TexCoord", TexCoord);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//indexed meshes draw from index_buffer, which is part of the vao's state:
+	if (index_buffer != 0) {
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+	}
 	glBindVertexArray(0);
 
 	//Check that all active attributes were bound:
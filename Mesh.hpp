@@ -1,8 +1,8 @@
 #pragma once
 
 /*
- * In this code, "Mesh" is a range of vertices that should be sent through
- *  the OpenGL pipeline together.
+ * In this code, "Mesh" is a range of vertices (or of indices into them) that
+ *  should be sent through the OpenGL pipeline together.
  * A "MeshBuffer" holds a collection of such meshes (loaded from a file) in
  *  a single OpenGL array buffer. Individual meshes can be looked up by name
  *  using the MeshBuffer::lookup() function.
@@ -10,18 +10,32 @@
  */
 
 #include "GL.hpp"
+#include "NameIndex.hpp"
 #include <glm/glm.hpp>
 #include <map>
 #include <limits>
+#include <memory>
 #include <string>
+#include <vector>
+
+struct MappedFile;
 
 
 struct Mesh {
-	//Meshes are vertex ranges (and primitive types) in their MeshBuffer:
+	//Meshes are vertex (or index) ranges (and primitive types) in their MeshBuffer:
 
 	GLenum type = GL_TRIANGLES; //type of primitives in mesh
-	GLuint start = 0; //index of first vertex
-	GLuint count = 0; //count of vertices
+	GLuint start = 0; //index of first vertex (or, for indexed meshes, of first index)
+	GLuint count = 0; //count of vertices (or indices)
+
+	//Indexed meshes draw 'count' indices from the MeshBuffer's index_buffer, each offset by 'base_vertex':
+	GLenum index_type = 0; //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT for indexed meshes, 0 for plain vertex ranges
+	GLint base_vertex = 0; //index of the mesh's first vertex in the MeshBuffer
+
+	//Compact MeshBuffers store positions relative to each mesh's bounding box (as normalized values in [-1,1]);
+	// object-space position = position_offset + position_scale * (stored position):
+	glm::vec3 position_offset = glm::vec3(0.0f);
+	glm::vec3 position_scale = glm::vec3(1.0f);
 
 	//Bounding box.
 	//useful for debug visualization and (perhaps, eventually) collision detection:
@@ -30,9 +44,26 @@ struct Mesh {
 };
 
 struct MeshBuffer {
+	//vertex layout to upload:
+	enum class VertexFormat {
+		Full, //as stored in the file: float positions, normals, texcoords (36 bytes / vertex)
+		Compact, //snorm16 positions (relative to mesh bounds), 10-10-10 snorm normals, half-float texcoords (20 bytes / vertex)
+	};
+
+	//when to create the OpenGL buffers:
+	enum UploadMode {
+		UploadNow, //in the constructor (needs the OpenGL context)
+		DeferUpload, //in upload() -- the constructor then makes no OpenGL calls, so it can run on a loading thread
+	};
+
 	//construct from a file:
 	// note: will throw if file fails to read.
-	MeshBuffer(std::string const &filename);
+	// note: with VertexFormat::Compact, drawables must also copy each Mesh's position_offset / position_scale
+	MeshBuffer(std::string const &filename, VertexFormat format = VertexFormat::Full, UploadMode upload_mode = UploadNow);
+	~MeshBuffer();
+
+	//create and fill 'buffer' and 'index_buffer' (on the OpenGL context thread) from data read by a DeferUpload constructor:
+	void upload();
 
 	//look up a particular mesh by name:
 	// note: will throw if mesh not found.
@@ -45,11 +76,28 @@ struct MeshBuffer {
 	//This is the OpenGL vertex buffer object containing the mesh data:
 	GLuint buffer = 0;
 
+	//..and (for files with indexed meshes) the buffer object with their indices, bound as the element array of each vao:
+	GLuint index_buffer = 0;
+
 	//-- internals ---
 
-	//used by the lookup() function:
+	//all the meshes, by name:
 	std::map< std::string, Mesh > meshes;
 
+	//used by the lookup() function (built by the constructor):
+	NameIndex< std::map< std::string, Mesh >::value_type const * > mesh_index;
+
+	//data read by the constructor but not yet passed to upload():
+	struct PendingUpload {
+		std::unique_ptr< MappedFile > file; //keeps pointers into the mapping valid
+		std::vector< char > vertex_storage, index_storage; //converted or realigned data (if not uploading straight from the file)
+		char const *vertex_data = nullptr;
+		size_t vertex_bytes = 0;
+		char const *index_data = nullptr;
+		size_t index_bytes = 0;
+	};
+	std::unique_ptr< PendingUpload > pending;
+
 	//These 'Attrib' structures describe the location of various attributes within the buffer (in exactly format wanted by glVertexAttribPointer). They are set when the file is loaded and are used by the "make_vao_for_program" call:
 	struct Attrib {
 		GLint size = 0;
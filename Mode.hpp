@@ -17,6 +17,11 @@ struct Mode : std::enable_shared_from_this< Mode > {
 	// 'elapsed' is time in seconds since the last call to 'update'
 	virtual void update(float elapsed) { }
 
+	//set_interpolation is called after update when updates run at a fixed rate (see main.cpp):
+	// 'alpha' in [0,1) is how far the frame about to be drawn is between the last update and the next,
+	// so draw can blend between the states of the last two updates
+	virtual void set_interpolation(float alpha) { }
+
 	//draw is called after update:
 	virtual void draw(glm::uvec2 const &drawable_size) = 0;
 
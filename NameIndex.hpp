@@ -0,0 +1,115 @@
+#pragma once
+
+/*
+ * NameIndex< T > maps names to values through their 64-bit FNV-1a hashes,
+ * stored in a flat open-addressing (linear probing) table:
+ *
+ * NameIndex< Mesh const * > index;
+ * index.insert(hash_name("body"), &mesh); //false (and no change) if the name is already present
+ * Mesh const * const *found = index.find(hash_name("body")); //nullptr if not present
+ *
+ * Only the hashes are stored, so lookups don't allocate or compare strings.
+ * (Two distinct names could, in principle, share a hash; where values know their names -- e.g., transforms -- callers check them.)
+ *
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//64-bit FNV-1a hash of a name:
+inline uint64_t hash_name(char const *name, size_t length) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < length; ++i) {
+		hash = (hash ^ uint8_t(name[i])) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+inline uint64_t hash_name(std::string const &name) {
+	return hash_name(name.data(), name.size());
+}
+
+template< typename T >
+struct NameIndex {
+	//remove all entries (keeps the table's storage):
+	void clear() {
+		keys.assign(keys.size(), Empty);
+		count = 0;
+	}
+
+	//make room for 'total' entries without rehashing:
+	void reserve(size_t total) {
+		size_t capacity = 16;
+		while (capacity < 2 * total) capacity *= 2; //keep the table at most half full
+		if (capacity > keys.size()) rehash(capacity);
+	}
+
+	//add an entry; returns false (leaving the existing value alone) if 'key' is already present:
+	bool insert(uint64_t key, T const &value) {
+		reserve(count + 1);
+		size_t slot = probe(key);
+		if (keys[slot] != Empty) return false;
+		keys[slot] = remap(key);
+		values[slot] = value;
+		++count;
+		return true;
+	}
+
+	//add or replace an entry:
+	void set(uint64_t key, T const &value) {
+		reserve(count + 1);
+		size_t slot = probe(key);
+		if (keys[slot] == Empty) {
+			keys[slot] = remap(key);
+			++count;
+		}
+		values[slot] = value;
+	}
+
+	//value for 'key', or nullptr if not present:
+	T *find(uint64_t key) {
+		if (keys.empty()) return nullptr;
+		size_t slot = probe(key);
+		return (keys[slot] == Empty ? nullptr : &values[slot]);
+	}
+	T const *find(uint64_t key) const {
+		return const_cast< NameIndex * >(this)->find(key);
+	}
+
+	size_t size() const { return count; }
+
+	//-- internals ---
+	static constexpr uint64_t Empty = 0; //keys that hash to Empty are stored as 1 instead
+	static uint64_t remap(uint64_t key) { return (key == Empty ? 1 : key); }
+
+	//slot holding 'key', or the empty slot where it would go:
+	size_t probe(uint64_t key) const {
+		assert(!keys.empty() && (keys.size() & (keys.size() - 1)) == 0);
+		key = remap(key);
+		size_t mask = keys.size() - 1;
+		size_t slot = size_t(key ^ (key >> 32)) & mask;
+		while (keys[slot] != Empty && keys[slot] != key) {
+			slot = (slot + 1) & mask;
+		}
+		return slot;
+	}
+
+	void rehash(size_t capacity) {
+		std::vector< uint64_t > old_keys(capacity, Empty);
+		std::vector< T > old_values(capacity);
+		old_keys.swap(keys);
+		old_values.swap(values);
+		for (size_t i = 0; i < old_keys.size(); ++i) {
+			if (old_keys[i] == Empty) continue;
+			size_t slot = probe(old_keys[i]);
+			keys[slot] = old_keys[i];
+			values[slot] = old_values[i];
+		}
+	}
+
+	std::vector< uint64_t > keys; //Empty or (remapped) name hash
+	std::vector< T > values;
+	size_t count = 0;
+};
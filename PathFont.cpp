@@ -3,6 +3,8 @@
 
 #include "PathFont.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 PathFont::PathFont(uint32_t glyphs_,
@@ -21,4 +23,40 @@ PathFont::PathFont(uint32_t glyphs_,
 			std::cerr << "WARNING: ignoring duplicate glyph for '" << str << "'." << std::endl;
 		}
 	}
+
+	//build tables for match():
+	std::fill(byte_glyphs, byte_glyphs + 256, -1U);
+	for (auto const &g : glyph_map) {
+		std::string const &str = g.first;
+		if (str.empty()) continue;
+		if (str.size() == 1) {
+			byte_glyphs[uint8_t(str[0])] = g.second;
+			continue;
+		}
+		//a greedy, byte-at-a-time match only gets to 'str' if every prefix is also a glyph:
+		bool reachable = true;
+		for (size_t len = 1; len < str.size(); ++len) {
+			if (!glyph_map.count(str.substr(0, len))) reachable = false;
+		}
+		if (reachable) long_glyphs[uint8_t(str[0])].emplace_back(g.second);
+	}
+	for (auto &list : long_glyphs) {
+		std::stable_sort(list.begin(), list.end(), [this](uint32_t a, uint32_t b) {
+			return glyph_char_starts[a+1] - glyph_char_starts[a] > glyph_char_starts[b+1] - glyph_char_starts[b];
+		});
+	}
+}
+
+uint32_t PathFont::match(const char *begin, const char *end, uint32_t *length) const {
+	*length = 1;
+	if (begin >= end) return -1U;
+	uint8_t first = uint8_t(*begin);
+	for (uint32_t g : long_glyphs[first]) {
+		uint32_t len = glyph_char_starts[g+1] - glyph_char_starts[g];
+		if (uint32_t(end - begin) >= len && std::memcmp(begin, chars + glyph_char_starts[g], len) == 0) {
+			*length = len;
+			return g;
+		}
+	}
+	return byte_glyphs[first];
 }
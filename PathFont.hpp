@@ -33,6 +33,15 @@ struct PathFont {
 	//computed in constructor:
 	std::map< std::string, uint32_t > glyph_map;
 
+	//find the glyph at the start of [begin,end), in O(1) and without allocating:
+	// (same result as growing a match one byte at a time while it is still in glyph_map)
+	// returns -1U if there isn't one; sets *length to the number of bytes matched (1 if there isn't one)
+	uint32_t match(const char *begin, const char *end, uint32_t *length) const;
+
+	//also computed in constructor, for match():
+	uint32_t byte_glyphs[256]; //glyph for each one-byte string (or -1U)
+	std::vector< uint32_t > long_glyphs[256]; //by first byte, longest first: glyphs for longer strings that match() can reach
+
 	//the default font:
 	static PathFont font;
 };
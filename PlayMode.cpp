@@ -3,8 +3,10 @@
 #include "LitColorTextureProgram.hpp"
 
 #include "DrawLines.hpp"
+#include "GPUTimer.hpp"
 #include "Load.hpp"
 #include "Mesh.hpp"
+#include "Profiler.hpp"
 #include "data_path.hpp"
 #include "gl_errors.hpp"
 
@@ -12,24 +14,36 @@
 #include <glm/gtx/string_cast.hpp>
 
 #include <algorithm>
+#include <cstdio>
 #include <random>
 
 GLuint program = 0;
-Load<MeshBuffer> load_meshes(LoadTagDefault, []() -> MeshBuffer const* {
-    MeshBuffer const* ret = new MeshBuffer(data_path("world.pnct"));
-    program = ret->make_vao_for_program(lit_color_texture_program->program);
-    return ret;
+GLuint instanced_program = 0; // vao for the instanced version of lit_color_texture_program
+// meshes are read and converted on a loading thread; only the upload and vao setup need the GL context:
+Load<MeshBuffer> load_meshes(LoadTagDefault, []() -> MeshBuffer* {
+    // (compact vertices: about half the memory and bandwidth of the file's float layout)
+    return new MeshBuffer(data_path("world.pnct"), MeshBuffer::VertexFormat::Compact, MeshBuffer::DeferUpload);
+}, [](MeshBuffer& buffer) {
+    buffer.upload();
+    program = buffer.make_vao_for_program(lit_color_texture_program->program);
+    instanced_program = buffer.make_vao_for_program(lit_color_texture_program->instanced_program);
 });
 
-// define static variable
-std::unordered_map<std::string, const Mesh*> Scene::all_meshes = {};
+// (transform, mesh name) pairs found while parsing world.scene (in parallel with the meshes),
+// hooked up to drawables once the meshes are ready:
+static std::vector<std::pair<Scene::Transform*, std::string>> scene_mesh_names;
 
-Load<Scene> load_scene(LoadTagDefault, []() -> Scene const* {
-    return new Scene(data_path("world.scene"), [&](Scene& scene, Scene::Transform* transform, std::string const& mesh_name) {
+Load<Scene> load_scene(LoadTagDefault, []() -> Scene* {
+    return new Scene(data_path("world.scene"), [](Scene&, Scene::Transform* transform, std::string const& mesh_name) {
+        scene_mesh_names.emplace_back(transform, mesh_name);
+    });
+}, [](Scene& scene) {
+    // n.b. load_meshes was added first, so it has finished by now
+    for (auto const& [transform, mesh_name] : scene_mesh_names) {
         Mesh const& mesh = load_meshes->lookup(mesh_name);
 
         // assign this mesh to the corresponding scene transform
-        Scene::all_meshes[transform->name] = &mesh;
+        Scene::all_meshes.set(hash_name(transform->name), &mesh);
 
         scene.drawables.emplace_back(transform);
         Scene::Drawable& drawable = scene.drawables.back();
@@ -37,108 +51,162 @@ Load<Scene> load_scene(LoadTagDefault, []() -> Scene const* {
         drawable.pipeline = lit_color_texture_program_pipeline;
 
         drawable.pipeline.vao = program;
+        drawable.pipeline.instanced.vao = instanced_program;
         drawable.pipeline.type = mesh.type;
         drawable.pipeline.start = mesh.start;
         drawable.pipeline.count = mesh.count;
-    });
+        drawable.pipeline.index_type = mesh.index_type;
+        drawable.pipeline.base_vertex = mesh.base_vertex;
+        drawable.pipeline.position_offset = mesh.position_offset;
+        drawable.pipeline.position_scale = mesh.position_scale;
+        drawable.min = mesh.min;
+        drawable.max = mesh.max;
+    }
+    scene_mesh_names.clear();
 });
 
-PlayMode::PlayMode()
-    : scene(*load_scene)
+PlayMode::PlayMode(bool sim_thread_, float tick_rate_)
+    : sim_thread(sim_thread_)
+    , tick_rate(tick_rate_)
 {
-
-    std::vector<std::string> vehicle_names = {
-        "car",
-        "car.001",
-        "car.002",
-        "car.003",
-        "car.004",
-        "car.005",
-        "car.006",
-        "car.007",
-        "car.008",
-        "car.009",
-        "car.010",
-        "car.011",
-        "car.012",
-        "car.013",
-        "car.014",
-        "car.015",
-        "car.016",
-        /// TODO: add cars in code, not model
-    };
-
-    // auto rng = std::default_random_engine {};
-    // std::shuffle(std::begin(vehicle_names), std::end(vehicle_names), rng);
-
-    for (const std::string& name : vehicle_names) {
-        FourWheeledVehicle* FWV = new FourWheeledVehicle(name);
-        FWV->initialize_from_scene(scene);
-        vehicle_map.push_back(FWV);
+    // copy-on-write copy of the loaded scene: only transforms (and cameras/lights) are duplicated,
+    // the drawables are shared with every other PlayMode
+    scene.snapshot(*load_scene);
+
+    // vehicles come pre-resolved from world.vehicles (see bake-vehicles.cpp), so there are no name lookups here
+    // unless the cache is missing or stale:
+    try {
+        vehicles.add_from_cache(data_path("world.vehicles"), scene);
+    } catch (std::exception const& e) {
+        std::cerr << "WARNING: " << e.what() << "; looking vehicles up by name instead." << std::endl;
+        for (const std::string& name : VehicleSystem::scene_vehicle_names()) {
+            vehicles.add_from_scene(name, scene);
+        }
     }
+    vehicles.jobs = &jobs;
 
     // the first vehicle will be the player
-    Player = vehicle_map[0];
-    std::cout << "Determined player to be \"" << Player->name << "\"" << std::endl;
-    Player->bIsPlayer = true;
-    Player->health = 10;
+    std::cout << "Determined player to be \"" << vehicles.name[Player] << "\"" << std::endl;
+    vehicles.health[Player] = 10;
 
     // get pointer to camera for convenience:
     if (scene.cameras.size() != 1)
         throw std::runtime_error("Expecting scene to have exactly one camera, but it has " + std::to_string(scene.cameras.size()));
     camera = &scene.cameras.front();
+
+    if (sim_thread) {
+        // the render thread gets its own copy of the transforms (and camera) to pose from published frames:
+        render_scene.snapshot(scene);
+        render_camera = &render_scene.cameras.front();
+        simulation = std::thread(&PlayMode::simulation_loop, this);
+    }
 }
 
 PlayMode::~PlayMode()
 {
+    if (simulation.joinable()) {
+        quit = true;
+        simulation.join();
+    }
+}
+
+void PlayMode::simulation_loop()
+{
+    using Clock = std::chrono::steady_clock;
+    const float elapsed = 1.0f / tick_rate;
+    const Clock::duration tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(elapsed));
+    Clock::time_point next = Clock::now() + tick;
+
+    while (!quit) {
+        std::this_thread::sleep_until(next);
+
+        Input input;
+        while (inputs.pop(&input)) {
+            apply_input(input);
+        }
+
+        simulate(elapsed);
+
+        Frame& frame = frames.write_buffer();
+        save_frame(frame, true);
+        frame.published = Clock::now();
+        frames.publish();
+
+        // (if far behind -- e.g., the process was suspended -- skip ahead instead of rushing to catch up)
+        next += tick;
+        if (Clock::now() > next + 8 * tick) {
+            next = Clock::now();
+        }
+    }
+}
+
+void PlayMode::save_frame(Frame& frame, bool with_poses) const
+{
+    frame.tick = ticks;
+    if (with_poses) {
+        frame.poses.resize(scene.transforms.size());
+        for (size_t i = 0; i < scene.transforms.size(); i++) {
+            const Scene::Transform& t = scene.transforms[i];
+            frame.poses[i] = Pose { t.position, t.rotation, t.scale };
+        }
+        frame.previous_poses = (previous_poses.size() == frame.poses.size() ? previous_poses : frame.poses);
+    }
+    frame.bounds = vehicles.bounds;
+    frame.health = vehicles.health[Player];
+    frame.was_hit = vehicles.timeLastHit[Player] > time - VehicleSystem::deltaHit;
+    frame.game_over = game_over;
+    frame.win = win;
 }
 
 bool PlayMode::handle_event(SDL_Event const& evt, glm::uvec2 const& window_size)
 {
+    // keys that drive the player's car:
+    auto car_button = [this](SDL_Keycode key) -> Button* {
+        switch (key) {
+        case SDLK_a:
+            return &left;
+        case SDLK_d:
+            return &right;
+        case SDLK_w:
+            return &up;
+        case SDLK_s:
+            return &down;
+        case SDLK_SPACE:
+            return &jump;
+        default:
+            return nullptr;
+        }
+    };
 
     if (evt.type == SDL_KEYDOWN) {
-        if (evt.key.keysym.sym == SDLK_ESCAPE) {
-            SDL_SetRelativeMouseMode(SDL_FALSE);
-            return true;
-        } else if (evt.key.keysym.sym == SDLK_a) {
-            left.downs += 1;
-            left.pressed = true;
+        if (Button* button = car_button(evt.key.keysym.sym)) {
+            send_input(Input { Input::Press, button, glm::vec2(0) });
             return true;
-        } else if (evt.key.keysym.sym == SDLK_d) {
-            right.downs += 1;
-            right.pressed = true;
-            return true;
-        } else if (evt.key.keysym.sym == SDLK_w) {
-            up.downs += 1;
-            up.pressed = true;
-            return true;
-        } else if (evt.key.keysym.sym == SDLK_s) {
-            down.downs += 1;
-            down.pressed = true;
-            return true;
-        } else if (evt.key.keysym.sym == SDLK_SPACE) {
-            jump.downs += 1;
-            jump.pressed = true;
+        } else if (evt.key.keysym.sym == SDLK_ESCAPE) {
+            SDL_SetRelativeMouseMode(SDL_FALSE);
             return true;
         } else if (evt.key.keysym.sym == SDLK_b) {
             bDrawBoundingBoxes = !bDrawBoundingBoxes;
             return true;
-        }
-    } else if (evt.type == SDL_KEYUP) {
-        if (evt.key.keysym.sym == SDLK_a) {
-            left.pressed = false;
+        } else if (evt.key.keysym.sym == SDLK_i) {
+            drawn_scene().instancing = !drawn_scene().instancing;
+            std::cout << "Instanced drawing " << (drawn_scene().instancing ? "on" : "off") << std::endl;
             return true;
-        } else if (evt.key.keysym.sym == SDLK_d) {
-            right.pressed = false;
+        } else if (evt.key.keysym.sym == SDLK_f) {
+            bDrawStats = !bDrawStats;
             return true;
-        } else if (evt.key.keysym.sym == SDLK_w) {
-            up.pressed = false;
+        } else if (evt.key.keysym.sym == SDLK_g) {
+            GPUTimer::enabled = !GPUTimer::enabled;
+            GPUTimer::log_csv(GPUTimer::enabled ? "gpu-times.csv" : "");
             return true;
-        } else if (evt.key.keysym.sym == SDLK_s) {
-            down.pressed = false;
+        } else if (evt.key.keysym.sym == SDLK_c) {
+            drawn_scene().culling = !drawn_scene().culling;
+            std::cout << "Frustum culling " << (drawn_scene().culling ? "on" : "off") << std::endl;
             return true;
-        } else if (evt.key.keysym.sym == SDLK_SPACE) {
-            jump.pressed = false;
+        }
+    } else if (evt.type == SDL_KEYUP) {
+        if (Button* button = car_button(evt.key.keysym.sym)) {
+            send_input(Input { Input::Release, button, glm::vec2(0) });
             return true;
         }
     } else if (evt.type == SDL_MOUSEBUTTONDOWN) {
@@ -148,9 +216,7 @@ bool PlayMode::handle_event(SDL_Event const& evt, glm::uvec2 const& window_size)
         }
     } else if (evt.type == SDL_MOUSEMOTION) {
         if (SDL_GetRelativeMouseMode() == SDL_TRUE) {
-            move = glm::vec2(
-                evt.motion.xrel / float(window_size.y),
-                -evt.motion.yrel / float(window_size.y));
+            send_input(Input { Input::Look, nullptr, glm::vec2(evt.motion.xrel / float(window_size.y), -evt.motion.yrel / float(window_size.y)) });
             return true;
         }
     }
@@ -158,8 +224,51 @@ bool PlayMode::handle_event(SDL_Event const& evt, glm::uvec2 const& window_size)
     return false;
 }
 
+void PlayMode::send_input(const Input& input)
+{
+    if (!sim_thread) {
+        apply_input(input);
+    } else if (!inputs.push(input)) {
+        std::cerr << "WARNING: simulation thread is not keeping up with input; dropping an input event." << std::endl;
+    }
+}
+
+void PlayMode::apply_input(const Input& input)
+{
+    if (input.type == Input::Press) {
+        input.button->downs += 1;
+        input.button->pressed = true;
+    } else if (input.type == Input::Release) {
+        input.button->pressed = false;
+    } else if (input.type == Input::Look) {
+        move += input.look; // (used up by the next simulate())
+    }
+}
+
 void PlayMode::update(float elapsed)
 {
+    if (!sim_thread) {
+        simulate(elapsed);
+        interpolation = 1.0f;
+    }
+}
+
+void PlayMode::simulate(float elapsed)
+{
+    PROFILE_ZONE("PlayMode::simulate");
+    ticks += 1;
+
+    // remember where everything was, to interpolate from when drawing
+    previous_poses.resize(scene.transforms.size());
+    for (size_t i = 0; i < scene.transforms.size(); i++) {
+        const Scene::Transform& t = scene.transforms[i];
+        previous_poses[i] = Pose { t.position, t.rotation, t.scale };
+    }
+
+    if (game_over && !win) {
+        // the player is dead, the arena stays frozen
+        return;
+    }
 
     time += elapsed;
     if (elapsed == 0) {
@@ -167,104 +276,63 @@ void PlayMode::update(float elapsed)
         return;
     }
 
-    if (vehicle_map.size() == 1 && vehicle_map[0]->bIsPlayer) {
+    if (vehicles.size() == 1) {
         // last one standing
         game_over = true;
         win = true;
     }
 
-    // update all the vehicles
-    for (FourWheeledVehicle* FWV : vehicle_map) {
-        if (!FWV->bIsPlayer) {
-            FWV->target = Player;
-            FWV->think(elapsed, vehicle_map); // determine target & controls
-        }
-        FWV->update(elapsed);
-        // check collisions
-        FWV->bounds.collided = false;
-        glm::vec3 heading = FWV->get_heading();
-        for (FourWheeledVehicle* otherFWV : vehicle_map) {
-            bool was_collision = (FWV->bounds.collides_with(otherFWV->bounds) || otherFWV->bounds.collides_with(FWV->bounds));
-            if (otherFWV != FWV && was_collision && time > 1) {
-                FWV->bounds.collided = true;
-
-                glm::vec3 dir = FWV->pos - otherFWV->pos; // scaled by distance
-                FWV->collision_force = 0.5f * dir / elapsed;
-                // check if got bumped
-                if (glm::dot(dir, heading) > 0 && time > FWV->timeLastHit + deltaHit) {
-                    FWV->health--;
-                    if (FWV->health == 0)
-                        FWV->die();
-                    FWV->timeLastHit = time;
-                    if (FWV->bIsPlayer)
-                        std::cout << "Ouch!!!" << std::endl; // got hit
-                }
-                break;
-            }
-        }
+    // think, move, and bonk all the vehicles
+    const float lastHit = vehicles.timeLastHit[Player];
+    if (!vehicles.step(elapsed, time)) {
+        game_over = true;
+        win = false;
+        return;
     }
-
-    {
-        // delete all disabled vehicles
-        std::vector<FourWheeledVehicle*> alive_vehicles = {};
-        for (FourWheeledVehicle* FWV : vehicle_map) {
-            if (FWV->enabled) {
-                alive_vehicles.push_back(FWV);
-            } else {
-                if (FWV->bIsPlayer) {
-                    game_over = true;
-                    win = false;
-                    return;
-                }
-                /// TODO: figure out a better/proper way to destroy
-                // move it to under the screen so it is invis
-                FWV->all->position = glm::vec3(0, 0, -100);
-            }
-        }
-
-        vehicle_map = std::move(alive_vehicles);
+    if (vehicles.timeLastHit[Player] != lastHit) {
+        std::cout << "Ouch!!!" << std::endl; // got hit
     }
 
     {
         // combine inputs into a move:
         if (left.pressed || right.pressed) {
-            const float wheel_turn_rate = Player->pos.z > 0 ? 2.f : 0.5f; // how many radians per second are turned
+            const float wheel_turn_rate = vehicles.pos[Player].z > 0 ? 2.f : 0.5f; // how many radians per second are turned
             float delta = elapsed * wheel_turn_rate;
             if (left.pressed && !right.pressed)
-                Player->turn_wheel(delta);
+                vehicles.turn_wheel(Player, delta);
             if (!left.pressed && right.pressed)
-                Player->turn_wheel(-delta);
+                vehicles.turn_wheel(Player, -delta);
         } else {
             // force feedback return steering wheel to 0
-            Player->steer += elapsed * 2.f * (0 - Player->steer);
+            vehicles.steer[Player] += elapsed * 2.f * (0 - vehicles.steer[Player]);
         }
         if (jump.pressed) {
-            if (!justJumped && Player->pos.z == 0) {
+            if (!justJumped && vehicles.pos[Player].z == 0) {
                 // give some initial velocity
-                Player->vel += glm::vec3(0, 0, 10);
+                vehicles.vel[Player] += glm::vec3(0, 0, 10);
                 justJumped = true;
             }
         } else {
             justJumped = false;
         }
 
-        // std::cout << Player->steer << std::endl;
+        // std::cout << vehicles.steer[Player] << std::endl;
 
         if (up.pressed || down.pressed) {
             if (down.pressed && !up.pressed) {
-                Player->throttle = 0;
-                Player->brake = 1;
+                vehicles.throttle[Player] = 0;
+                vehicles.brake[Player] = 1;
             }
             if (!down.pressed && up.pressed) {
-                Player->throttle = 1;
-                Player->brake = 0;
+                vehicles.throttle[Player] = 1;
+                vehicles.brake[Player] = 0;
             }
         } else {
-            Player->throttle = 0;
-            Player->brake = 0;
+            vehicles.throttle[Player] = 0;
+            vehicles.brake[Player] = 0;
         }
         /// TODO: rotate camera?
-        camera->transform->position = Player->pos + camera_offset;
+        camera->transform->position = vehicles.pos[Player] + camera_offset;
     }
 
     // move camera:
@@ -287,7 +355,7 @@ void PlayMode::update(float elapsed)
         camera_offset /= glm::length(camera_offset);
         camera_offset *= camera_arm_length;
 
-        glm::vec3 dir = glm::normalize(Player->all->position - camera->transform->position);
+        glm::vec3 dir = glm::normalize(vehicles.parts[Player].all->position - camera->transform->position);
         /// TODO: fix the spinning when go directly over and up is parallel to dir
         camera->transform->rotation = glm::quatLookAt(dir, glm::vec3(0, 0, 1));
     }
@@ -299,10 +367,73 @@ void PlayMode::update(float elapsed)
     down.downs = 0;
 }
 
+void PlayMode::set_interpolation(float alpha)
+{
+    interpolation = alpha;
+}
+
 void PlayMode::draw(glm::uvec2 const& drawable_size)
 {
+    PROFILE_ZONE("PlayMode::draw");
+
+    // what to show of the simulation:
+    const Frame* shown = &hud_frame;
+    if (sim_thread) {
+        // pose the render copy of the scene between the newest frame's before- and after-tick states,
+        // by how long ago (in ticks) that frame was published
+        // n.b. transforms are only written if they change, so cached world matrices of still transforms stay valid
+        frames.update();
+        const Frame& frame = frames.read_buffer();
+        shown = &frame;
+        if (frame.tick != 0 && frame.poses.size() == render_scene.transforms.size()) {
+            const float since = std::chrono::duration<float>(std::chrono::steady_clock::now() - frame.published).count();
+            const float alpha = std::min(1.0f, since * tick_rate);
+            for (size_t i = 0; i < render_scene.transforms.size(); i++) {
+                Scene::Transform& t = render_scene.transforms[i];
+                const Pose& from = frame.previous_poses[i];
+                const Pose& to = frame.poses[i];
+                const glm::vec3 position = (from.position == to.position ? to.position : glm::mix(from.position, to.position, alpha));
+                const glm::quat rotation = (from.rotation == to.rotation ? to.rotation : glm::slerp(from.rotation, to.rotation, alpha));
+                const glm::vec3 scale = (from.scale == to.scale ? to.scale : glm::mix(from.scale, to.scale, alpha));
+                if (t.position != position) {
+                    t.position = position;
+                }
+                if (t.rotation != rotation) {
+                    t.rotation = rotation;
+                }
+                if (t.scale != scale) {
+                    t.scale = scale;
+                }
+            }
+        }
+    } else {
+        save_frame(hud_frame, false);
+    }
+    Scene& drawn = drawn_scene();
+    Scene::Camera* view = drawn_camera();
+
+    // without a simulation thread, draw the scene between its last two updated states (and put the current state back afterwards)
+    // n.b. unchanged transforms are left alone, so their cached world matrices stay valid
+    const bool interpolate = !sim_thread && interpolation < 1.0f && previous_poses.size() == scene.transforms.size();
+    if (interpolate) {
+        current_poses.resize(scene.transforms.size());
+        for (size_t i = 0; i < scene.transforms.size(); i++) {
+            Scene::Transform& t = scene.transforms[i];
+            const Pose& from = previous_poses[i];
+            current_poses[i] = Pose { t.position, t.rotation, t.scale };
+            if (from.position != t.position) {
+                t.position = glm::mix(from.position, t.position, interpolation);
+            }
+            if (from.rotation != t.rotation) {
+                t.rotation = glm::slerp(from.rotation, t.rotation, interpolation);
+            }
+            if (from.scale != t.scale) {
+                t.scale = glm::mix(from.scale, t.scale, interpolation);
+            }
+        }
+    }
     // update camera aspect ratio for drawable:
-    camera->aspect = float(drawable_size.x) / float(drawable_size.y);
+    view->aspect = float(drawable_size.x) / float(drawable_size.y);
 
     // set up light type and position for lit_color_texture_program:
     //  TODO: consider using the Light(s) in the scene to do this
@@ -310,18 +441,27 @@ void PlayMode::draw(glm::uvec2 const& drawable_size)
     glUniform1i(lit_color_texture_program->LIGHT_TYPE_int, 1);
     glUniform3fv(lit_color_texture_program->LIGHT_DIRECTION_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 0.0f, -1.0f)));
     glUniform3fv(lit_color_texture_program->LIGHT_ENERGY_vec3, 1, glm::value_ptr(glm::vec3(1.0f, 1.0f, 0.95f)));
+    // (the instanced version has its own copies of these uniforms)
+    glUseProgram(lit_color_texture_program->instanced_program);
+    glUniform1i(lit_color_texture_program->instanced_LIGHT_TYPE_int, 1);
+    glUniform3fv(lit_color_texture_program->instanced_LIGHT_DIRECTION_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 0.0f, -1.0f)));
+    glUniform3fv(lit_color_texture_program->instanced_LIGHT_ENERGY_vec3, 1, glm::value_ptr(glm::vec3(1.0f, 1.0f, 0.95f)));
     glUseProgram(0);
 
-    glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
-    glClearDepth(1.0f); // 1.0 is actually the default value to clear the depth buffer to, but FYI you can change it.
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    {
+        GPUTimer timer("scene");
+
+        glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+        glClearDepth(1.0f); // 1.0 is actually the default value to clear the depth buffer to, but FYI you can change it.
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS); // this is the default depth comparison function, but FYI you can change it.
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS); // this is the default depth comparison function, but FYI you can change it.
 
-    GL_ERRORS(); // print any errors produced by this setup code
+        GL_ERRORS(); // print any errors produced by this setup code
 
-    scene.draw(*camera);
+        drawn.draw(*view);
+    }
 
     {
         // use DrawLines to overlay some text:
@@ -333,8 +473,10 @@ void PlayMode::draw(glm::uvec2 const& drawable_size)
             0.0f, 0.0f, 1.0f, 0.0f,
             0.0f, 0.0f, 0.0f, 1.0f);
 
-        if (game_over) {
+        if (shown->game_over) {
             DrawLines lines(projection, true);
+            lines.gpu_pass = "HUD";
+            const bool win = shown->win;
             float win_message_width = win ? 0.5f : 0.9f;
             float win_message_height = 0.3f;
             auto win_message = win ? "VICTORY ACHIEVED!" : "YOU DIED";
@@ -348,27 +490,73 @@ void PlayMode::draw(glm::uvec2 const& drawable_size)
 
         } else {
             DrawLines lines(projection, false);
+            lines.gpu_pass = "HUD";
             constexpr float H = 0.2f;
             float ofs = 2.0f / drawable_size.y;
-            bool bWasHit = Player->timeLastHit > time - deltaHit;
+            bool bWasHit = shown->was_hit;
             glm::u8vec4 text_colour = bWasHit ? glm::u8vec4(0xff, 0x00, 0x00, 0xf0) : glm::u8vec4(0xff, 0xff, 0xff, 0xf0);
-            lines.draw_text("Health: " + std::to_string(int(Player->health)),
+            lines.draw_text("Health: " + std::to_string(int(shown->health)),
                 glm::vec3(-aspect + 0.1f * H + ofs, -1.0 + +0.1f * H + ofs, 0.0),
                 glm::vec3(H, 0.0f, 0.0f), glm::vec3(0.0f, H, 0.0f),
                 text_colour);
         }
+
+        if (bDrawStats) {
+            DrawLines lines(projection, false);
+            lines.gpu_pass = "HUD";
+            constexpr float H = 0.07f;
+            float ofs = 2.0f / drawable_size.y;
+            Scene::DrawStats const& stats = drawn.draw_stats;
+            std::string text = std::to_string(stats.drawables) + " drawables (" + std::to_string(stats.culled) + " culled) in " + std::to_string(stats.draw_calls) + " draws;"
+                + " program " + std::to_string(stats.program_changes) + "/" + std::to_string(stats.program_changes + stats.program_changes_avoided)
+                + " vao " + std::to_string(stats.vao_changes) + "/" + std::to_string(stats.vao_changes + stats.vao_changes_avoided)
+                + " texture " + std::to_string(stats.texture_changes) + "/" + std::to_string(stats.texture_changes + stats.texture_changes_avoided);
+            lines.draw_text(text,
+                glm::vec3(-aspect + 0.1f * H + ofs, 1.0f - 1.1f * H + ofs, 0.0),
+                glm::vec3(H, 0.0f, 0.0f), glm::vec3(0.0f, H, 0.0f),
+                glm::u8vec4(0xff, 0xff, 0xff, 0xf0));
+        }
+
+        if (GPUTimer::enabled) {
+            // per-pass GPU times (from a few frames ago; see GPUTimer.hpp):
+            DrawLines lines(projection, false);
+            lines.gpu_pass = "HUD";
+            constexpr float H = 0.07f;
+            float ofs = 2.0f / drawable_size.y;
+            float y = 1.0f - 2.2f * H;
+            for (GPUTimer::PassStats const& s : GPUTimer::stats()) {
+                char text[128];
+                std::snprintf(text, sizeof(text), "GPU %s: min %.2f avg %.2f p99 %.2f ms", s.pass, s.min_ms, s.avg_ms, s.p99_ms);
+                lines.draw_text(text,
+                    glm::vec3(-aspect + 0.1f * H + ofs, y + ofs, 0.0),
+                    glm::vec3(H, 0.0f, 0.0f), glm::vec3(0.0f, H, 0.0f),
+                    glm::u8vec4(0xff, 0xff, 0x80, 0xf0));
+                y -= 1.1f * H;
+            }
+        }
     }
 
     // draw lines in 3D space
     if (bDrawBoundingBoxes) {
         glDisable(GL_DEPTH_TEST);
-        glm::mat4 world_to_clip = camera->make_projection() * glm::mat4(camera->transform->make_world_to_local());
+        glm::mat4 world_to_clip = view->make_projection() * glm::mat4(view->transform->make_world_to_local());
 
         DrawLines lines(world_to_clip);
-        for (FourWheeledVehicle* FWV : vehicle_map) {
+        lines.gpu_pass = "debug boxes";
+        for (const BBox& bounds : shown->bounds) {
             // draw bounding box
-            auto collision_colour = FWV->bounds.collided ? glm::u8vec4(0xff, 0x0, 0x0, 0xff) : glm::u8vec4(0xff);
-            lines.draw_box(FWV->bounds.get_mat(), collision_colour);
+            auto collision_colour = bounds.collided ? glm::u8vec4(0xff, 0x0, 0x0, 0xff) : glm::u8vec4(0xff);
+            lines.draw_box(bounds.get_mat(), collision_colour);
+        }
+    }
+
+    if (interpolate) {
+        for (size_t i = 0; i < scene.transforms.size(); i++) {
+            Scene::Transform& t = scene.transforms[i];
+            const Pose& pose = current_poses[i];
+            t.position = pose.position;
+            t.rotation = pose.rotation;
+            t.scale = pose.scale;
         }
     }
 }
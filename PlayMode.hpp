@@ -1,24 +1,33 @@
 #include "Mode.hpp"
 
-#include "AssetMesh.hpp"
 #include "BBox.hpp"
+#include "JobPool.hpp"
+#include "SPSCQueue.hpp"
 #include "Scene.hpp"
+#include "TripleBuffer.hpp"
 #include "Utils.hpp"
+#include "VehicleSystem.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtx/string_cast.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <deque>
 #include <iostream>
+#include <thread>
 #include <vector>
 
 struct PlayMode : Mode {
-    PlayMode();
+    // with sim_thread, the game is simulated on its own thread at tick_rate (and update() does nothing);
+    // otherwise it is simulated by update()
+    PlayMode(bool sim_thread = false, float tick_rate = 120.0f);
     virtual ~PlayMode();
 
     // functions called by main loop:
     virtual bool handle_event(SDL_Event const&, glm::uvec2 const& window_size) override;
     virtual void update(float elapsed) override;
+    virtual void set_interpolation(float alpha) override;
     virtual void draw(glm::uvec2 const& drawable_size) override;
 
     //----- game state -----
@@ -31,8 +40,8 @@ struct PlayMode : Mode {
 
     bool justJumped = false;
     bool bDrawBoundingBoxes = false;
+    bool bDrawStats = false; // overlay Scene::draw_stats
     bool bCanGetHit = true;
-    static constexpr float deltaHit = 0.25; // minimum time between consecutive hits
     float time = 0; // time of the world
 
     // local copy of the game scene (so code can change it during gameplay):
@@ -41,8 +50,9 @@ struct PlayMode : Mode {
     bool win = true;
 
     // all the vehicles in the scene
-    std::vector<FourWheeledVehicle*> vehicle_map;
-    FourWheeledVehicle* Player = nullptr;
+    VehicleSystem vehicles;
+    JobPool jobs { JobPool::default_workers() }; // runs the vehicle kernels across cores
+    static constexpr size_t Player = VehicleSystem::player;
 
     // camera:
     glm::vec2 move = glm::vec2(0, 0);
@@ -52,4 +62,64 @@ struct PlayMode : Mode {
     float mouse_drag_speed_y = -10;
     float mouse_scroll_speed = 5;
     Scene::Camera* camera = nullptr;
+
+    // render interpolation: update runs at a fixed rate, and draw blends every scene transform
+    // from its pose before the last update toward its current pose by "interpolation"
+    struct Pose {
+        glm::vec3 position;
+        glm::quat rotation;
+        glm::vec3 scale;
+    };
+    std::vector<Pose> previous_poses; // saved at the start of each update
+    std::vector<Pose> current_poses; // scratch, to restore the simulated poses after drawing
+    float interpolation = 1.0f;
+
+    // advance the game by elapsed seconds (called by update(), or by the simulation thread)
+    void simulate(float elapsed);
+    uint64_t ticks = 0; // simulate() calls so far
+
+    // inputs that affect the simulation, applied at the next simulate():
+    struct Input {
+        enum Type : uint8_t {
+            Press,
+            Release,
+            Look,
+        } type;
+        Button* button; // for Press/Release
+        glm::vec2 look; // for Look
+    };
+    void send_input(const Input& input); // from handle_event (goes through "inputs" with a simulation thread)
+    void apply_input(const Input& input);
+
+    // everything draw() needs from the simulation:
+    struct Frame {
+        uint64_t tick = 0; // 0 if nothing has been simulated yet
+        std::chrono::steady_clock::time_point published;
+        std::vector<Pose> previous_poses, poses; // every scene transform, before and after the tick
+        std::vector<BBox> bounds; // every vehicle
+        float health = 0;
+        bool was_hit = false;
+        bool game_over = false;
+        bool win = true;
+    };
+    void save_frame(Frame& frame, bool with_poses) const;
+    Frame hud_frame; // without a simulation thread, refreshed at every draw()
+
+    //----- simulation thread -----
+    // The simulation thread owns "scene", "vehicles", "camera" and the rest of the game state above.
+    // It publishes a Frame after every tick through "frames", and draw() poses "render_scene" -- a copy of
+    // the scene (sharing its drawables) -- from the newest one, so a slow tick never holds up a frame.
+    bool sim_thread = false;
+    float tick_rate = 120.0f;
+    Scene render_scene;
+    Scene::Camera* render_camera = nullptr;
+    TripleBuffer<Frame> frames;
+    SPSCQueue<Input, 256> inputs;
+    std::atomic<bool> quit { false };
+    std::thread simulation;
+    void simulation_loop();
+
+    // the scene (and camera) draw() shows:
+    Scene& drawn_scene() { return sim_thread ? render_scene : scene; }
+    Scene::Camera* drawn_camera() { return sim_thread ? render_camera : camera; }
 };
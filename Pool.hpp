@@ -0,0 +1,133 @@
+#pragma once
+
+/*
+ * Pool< T > is an append-only container whose elements never move:
+ * they live in fixed-size chunks (so, unlike std::vector, pointers to them stay valid as it grows),
+ * and each chunk holds many elements (so, unlike std::list, there is no allocation per element and
+ * iteration walks through contiguous memory).
+ *
+ * Pool< Thing > things;
+ * Thing &thing = things.emplace_back(...);
+ * size_t handle = things.index_of(&thing); //indices are stable too, and are how copies find "the same" element
+ * for (Thing &t : things) { ... }
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template< typename T, size_t ChunkSize = 256 >
+struct Pool {
+	static_assert((ChunkSize & (ChunkSize - 1)) == 0, "ChunkSize should be a power of two.");
+
+	Pool() = default;
+	Pool(Pool const &other) { *this = other; }
+	Pool &operator=(Pool const &other) {
+		if (this == &other) return *this;
+		clear();
+		reserve(other.count);
+		for (size_t c = 0; c * ChunkSize < other.count; ++c) {
+			size_t n = std::min(ChunkSize, other.count - c * ChunkSize);
+			if constexpr (std::is_trivially_copyable< T >::value) {
+				std::memcpy(static_cast< void * >(chunks[c]), other.chunks[c], n * sizeof(T));
+			} else {
+				for (size_t i = 0; i < n; ++i) {
+					new (chunks[c] + i) T(other.chunks[c][i]);
+				}
+			}
+		}
+		count = other.count;
+		return *this;
+	}
+	~Pool() {
+		clear();
+		std::allocator< T > allocator;
+		for (T *chunk : chunks) allocator.deallocate(chunk, ChunkSize);
+	}
+
+	template< typename... Args >
+	T &emplace_back(Args&&... args) {
+		reserve(count + 1);
+		T *t = new (chunks[count / ChunkSize] + (count % ChunkSize)) T(std::forward< Args >(args)...);
+		++count;
+		return *t;
+	}
+
+	//destroy all elements (keeps the chunks for re-use):
+	void clear() {
+		if constexpr (!std::is_trivially_destructible< T >::value) {
+			for (size_t i = 0; i < count; ++i) (*this)[i].~T();
+		}
+		count = 0;
+	}
+
+	//allocate chunks for at least 'total' elements:
+	void reserve(size_t total) {
+		std::allocator< T > allocator;
+		while (chunks.size() * ChunkSize < total) {
+			chunks.emplace_back(allocator.allocate(ChunkSize));
+		}
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	T &operator[](size_t i) { assert(i < count); return chunks[i / ChunkSize][i % ChunkSize]; }
+	T const &operator[](size_t i) const { assert(i < count); return chunks[i / ChunkSize][i % ChunkSize]; }
+	T &front() { return (*this)[0]; }
+	T const &front() const { return (*this)[0]; }
+	T &back() { return (*this)[count - 1]; }
+	T const &back() const { return (*this)[count - 1]; }
+
+	//index of an element of this pool (or size() if 't' isn't one), found by checking each chunk's range:
+	size_t index_of(T const *t) const {
+		for (size_t c = 0; c < chunks.size(); ++c) {
+			//n.b. compared as integers, since pointers into different allocations aren't ordered:
+			uintptr_t offset = reinterpret_cast< uintptr_t >(t) - reinterpret_cast< uintptr_t >(chunks[c]);
+			if (offset < ChunkSize * sizeof(T)) {
+				size_t i = c * ChunkSize + offset / sizeof(T);
+				return (i < count ? i : count);
+			}
+		}
+		return count;
+	}
+
+	template< typename P, typename V >
+	struct Iterator {
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = V *;
+		using reference = V &;
+
+		P *pool = nullptr;
+		size_t index = 0;
+
+		V &operator*() const { return (*pool)[index]; }
+		V *operator->() const { return &(*pool)[index]; }
+		Iterator &operator++() { ++index; return *this; }
+		Iterator operator++(int) { Iterator ret = *this; ++index; return ret; }
+		bool operator==(Iterator const &o) const { return index == o.index; }
+		bool operator!=(Iterator const &o) const { return index != o.index; }
+	};
+	using iterator = Iterator< Pool, T >;
+	using const_iterator = Iterator< Pool const, T const >;
+
+	iterator begin() { return iterator{this, 0}; }
+	iterator end() { return iterator{this, count}; }
+	const_iterator begin() const { return const_iterator{this, 0}; }
+	const_iterator end() const { return const_iterator{this, count}; }
+
+	//-- internals ---
+	std::vector< T * > chunks; //each has room for ChunkSize elements; the first 'count' elements are constructed
+	size_t count = 0;
+};
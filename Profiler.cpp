@@ -0,0 +1,135 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+	//zone fields are (relaxed) atomics so write_chrome_trace can read a ring while its thread records into it;
+	// a slot the reader may have caught mid-overwrite is detected (and dropped) by re-checking 'recorded':
+	struct Zone {
+		std::atomic< char const * > name;
+		std::atomic< uint64_t > begin, end;
+	};
+
+	struct ZoneCopy {
+		char const *name;
+		uint64_t begin, end;
+	};
+
+	struct Ring {
+		std::unique_ptr< Zone[] > zones{new Zone[Profiler::RingSize]};
+		std::atomic< uint64_t > recorded{0}; //total zones ever recorded (the newest RingSize are in 'zones')
+		uint32_t thread = 0; //index, for the trace's "tid"
+	};
+
+	//trace times are relative to when the program started:
+	uint64_t const trace_start = Profiler::now();
+
+	//every thread's ring (rings outlive their threads, so zones from finished threads can still be written):
+	std::mutex rings_mutex;
+	std::vector< std::unique_ptr< Ring > > &get_rings() {
+		static std::vector< std::unique_ptr< Ring > > rings;
+		return rings;
+	}
+
+	Ring &this_thread_ring() {
+		thread_local Ring *ring = nullptr;
+		if (!ring) {
+			std::unique_lock< std::mutex > lock(rings_mutex);
+			auto &rings = get_rings();
+			rings.emplace_back(new Ring);
+			ring = rings.back().get();
+			ring->thread = uint32_t(rings.size() - 1);
+		}
+		return *ring;
+	}
+}
+
+void Profiler::record(char const *name, uint64_t begin, uint64_t end) {
+	Ring &ring = this_thread_ring();
+	uint64_t index = ring.recorded.load(std::memory_order_relaxed);
+	//(pairs with the reader's acquire fence: a reader that sees this zone's slot also sees 'recorded' >= index)
+	std::atomic_thread_fence(std::memory_order_release);
+	Zone &zone = ring.zones[index % RingSize];
+	zone.name.store(name, std::memory_order_relaxed);
+	zone.begin.store(begin, std::memory_order_relaxed);
+	zone.end.store(end, std::memory_order_relaxed);
+	ring.recorded.store(index + 1, std::memory_order_release);
+}
+
+bool Profiler::write_chrome_trace(std::string const &filename) {
+	std::ofstream out(filename, std::ios::binary);
+	if (!out) {
+		std::cerr << "Failed to open '" << filename << "' for writing." << std::endl;
+		return false;
+	}
+
+	//json-escape a zone name:
+	auto write_name = [&out](char const *name) {
+		out << '"';
+		for (char const *c = name; *c; ++c) {
+			if (*c == '"' || *c == '\\') out << '\\';
+			if (uint8_t(*c) < 0x20) out << ' ';
+			else out << *c;
+		}
+		out << '"';
+	};
+
+	//nanoseconds as (exact) decimal microseconds:
+	auto write_us = [&out](uint64_t ns) {
+		char frac[4] = {char('0' + ns / 100 % 10), char('0' + ns / 10 % 10), char('0' + ns % 10), '\0'};
+		out << ns / 1000 << '.' << frac;
+	};
+
+	std::unique_lock< std::mutex > lock(rings_mutex);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	uint64_t total = 0;
+	std::vector< ZoneCopy > copied;
+	for (auto const &ring : get_rings()) {
+		//copy the ring (its thread may still be recording):
+		uint64_t recorded = ring->recorded.load(std::memory_order_acquire);
+		uint64_t oldest = (recorded > RingSize ? recorded - RingSize : 0);
+		copied.clear();
+		copied.reserve(size_t(recorded - oldest));
+		for (uint64_t i = oldest; i < recorded; ++i) {
+			Zone const &zone = ring->zones[i % RingSize];
+			copied.emplace_back(ZoneCopy{
+				zone.name.load(std::memory_order_relaxed),
+				zone.begin.load(std::memory_order_relaxed),
+				zone.end.load(std::memory_order_relaxed)
+			});
+		}
+		//...then drop any zones that were (or are being) overwritten while copying:
+		// (zone 'recorded_after' may be mid-write into the slot of zone 'recorded_after - RingSize')
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t recorded_after = ring->recorded.load(std::memory_order_relaxed);
+		uint64_t valid = (recorded_after + 1 > RingSize ? recorded_after + 1 - RingSize : 0);
+		if (valid > oldest) {
+			copied.erase(copied.begin(), copied.begin() + size_t(std::min(valid, recorded) - oldest));
+			oldest = std::min(valid, recorded);
+		}
+
+		for (ZoneCopy const &zone : copied) {
+			if (!first) out << ",\n";
+			first = false;
+			out << "{\"name\":";
+			write_name(zone.name);
+			out << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << ring->thread << ",\"ts\":";
+			write_us(zone.begin > trace_start ? zone.begin - trace_start : 0);
+			out << ",\"dur\":";
+			write_us(zone.end > zone.begin ? zone.end - zone.begin : 0);
+			out << "}";
+		}
+		total += copied.size();
+	}
+	out << "\n]}\n";
+
+	std::cout << "Wrote " << total << " profile zones from " << get_rings().size() << " threads to '" << filename << "'." << std::endl;
+	return bool(out);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+ * Profiler -- lightweight scoped timing zones, for finding frame spikes:
+ *
+ * void expensive() {
+ *     PROFILE_ZONE("expensive");
+ *     ...
+ * }
+ *
+ * //later (e.g., on a key press, between frames):
+ * Profiler::write_chrome_trace("profile.json"); //open in chrome://tracing or ui.perfetto.dev
+ *
+ * Each thread records into its own fixed-size ring of recent zones, so recording
+ * never allocates or locks (only a thread's first zone does, to set up its ring).
+ * Once a ring is full, its oldest zones are overwritten.
+ *
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace Profiler {
+	//timestamp, in nanoseconds (since an arbitrary epoch):
+	inline uint64_t now() {
+		return uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	//add a finished zone to this thread's ring:
+	// (name must stay valid until written -- in practice, a string literal)
+	void record(char const *name, uint64_t begin, uint64_t end);
+
+	//write every thread's recorded zones as Chrome trace_event JSON ("complete" events, times in microseconds):
+	// safe to call while other threads are recording (zones they overwrite during the call are left out); returns false if the file can't be written
+	bool write_chrome_trace(std::string const &filename);
+
+	//number of zones kept per thread:
+	constexpr uint32_t RingSize = 1 << 16;
+}
+
+//times from construction to destruction:
+struct ProfileZone {
+	ProfileZone(char const *name_) : name(name_), begin(Profiler::now()) { }
+	~ProfileZone() { Profiler::record(name, begin, Profiler::now()); }
+	ProfileZone(ProfileZone const &) = delete;
+	ProfileZone &operator=(ProfileZone const &) = delete;
+
+	char const *name;
+	uint64_t begin;
+};
+
+#define PROFILE_ZONE_CONCAT2(A, B) A ## B
+#define PROFILE_ZONE_CONCAT(A, B) PROFILE_ZONE_CONCAT2(A, B)
+#define PROFILE_ZONE(NAME) ProfileZone PROFILE_ZONE_CONCAT(profile_zone_, __LINE__)(NAME)
@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+ * SPSCQueue< T, Capacity > is a fixed-size, lock-free FIFO between exactly one producer thread
+ * and one consumer thread:
+ *
+ * SPSCQueue< Input, 256 > inputs;
+ *
+ * //producer:
+ * if (!inputs.push(input)) { ...full... }
+ *
+ * //consumer:
+ * Input input;
+ * while (inputs.pop(&input)) { ... }
+ *
+ * Head and tail only ever increase (and wrap around via Capacity, a power of two),
+ * and live on separate cache lines so the two threads don't fight over them.
+ *
+ */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+template< typename T, size_t Capacity >
+struct SPSCQueue {
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity should be a power of two.");
+
+	//(producer) add a value; returns false (and does nothing) if the queue is full:
+	bool push(T const &value) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+		slots[t & (Capacity - 1)] = value;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	//(consumer) remove the oldest value; returns false if the queue is empty:
+	bool pop(T *value) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) return false;
+		*value = slots[h & (Capacity - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	//-- internals ---
+	std::array< T, Capacity > slots;
+	alignas(64) std::atomic< size_t > head{0}; //next to pop (written by consumer)
+	alignas(64) std::atomic< size_t > tail{0}; //next to push (written by producer)
+};
@@ -1,11 +1,17 @@
 #include "Scene.hpp"
 
 #include "gl_errors.hpp"
-#include "read_write_chunk.hpp"
+#include "MappedFile.hpp"
+#include "Profiler.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
-#include <fstream>
+#include <algorithm>
+#include <iostream>
+
+//-------------------------
+
+NameIndex< Mesh const * > Scene::all_meshes;
 
 //-------------------------
 
@@ -71,6 +77,48 @@ glm::mat4x3 Scene::Transform::make_world_to_local() const {
 	}
 }
 
+//visit 't' (after its ancestors) in update pass 'pass', recomputing its cached matrix if anything it depends on changed:
+static void update_world_matrix(Scene::Transform const &t, uint32_t pass, uint32_t *recomputed) {
+	Scene::Transform::WorldCache &cache = t.world_cache;
+	if (cache.pass == pass) return;
+	cache.pass = pass;
+
+	uint32_t parent_version = 0;
+	if (t.parent) {
+		update_world_matrix(*t.parent, pass, recomputed);
+		parent_version = t.parent->world_cache.version;
+	}
+
+	if (cache.valid
+	 && cache.parent == t.parent && cache.parent_version == parent_version
+	 && cache.position == t.position && cache.rotation == t.rotation && cache.scale == t.scale) {
+		return;
+	}
+
+	if (!t.parent) {
+		cache.local_to_world = t.make_local_to_parent();
+	} else {
+		cache.local_to_world = t.parent->world_cache.local_to_world * glm::mat4(t.make_local_to_parent()); //note: glm::mat4(glm::mat4x3) pads with a (0,0,0,1) row
+	}
+	cache.valid = true;
+	cache.position = t.position;
+	cache.rotation = t.rotation;
+	cache.scale = t.scale;
+	cache.parent = t.parent;
+	cache.parent_version = parent_version;
+	cache.version += 1;
+	*recomputed += 1;
+}
+
+uint32_t Scene::update_world_matrices() const {
+	world_pass += 1;
+	uint32_t recomputed = 0;
+	for (auto const &t : transforms) {
+		update_world_matrix(t, world_pass, &recomputed);
+	}
+	return recomputed;
+}
+
 //-------------------------
 
 glm::mat4 Scene::Camera::make_projection() const {
@@ -87,36 +135,294 @@ void Scene::draw(Camera const &camera) const {
 	draw(world_to_clip, world_to_light);
 }
 
+//can this drawable be drawn through its instanced pipeline?
+static bool can_instance(Scene::Drawable const &drawable) {
+	Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
+	return pipeline.instanced.program != 0
+	    && pipeline.instanced.vao != 0
+	    && !pipeline.set_uniforms; //custom uniforms are per-drawable, so can't be shared by a batch
+}
+
+//drawables can share an instanced draw call if everything but their transform matches:
+static bool same_batch(Scene::Drawable::Pipeline const &a, Scene::Drawable::Pipeline const &b) {
+	if (a.instanced.program != b.instanced.program) return false;
+	if (a.instanced.vao != b.instanced.vao) return false;
+	if (a.type != b.type || a.start != b.start || a.count != b.count) return false;
+	if (a.index_type != b.index_type || a.base_vertex != b.base_vertex) return false;
+	for (uint32_t i = 0; i < Scene::Drawable::Pipeline::TextureCount; ++i) {
+		if (a.textures[i].texture != b.textures[i].texture) return false;
+		if (a.textures[i].target != b.textures[i].target) return false;
+	}
+	return true;
+}
+
+//strict ordering consistent with same_batch, used to gather batches:
+static bool batch_less(Scene::Drawable::Pipeline const &a, Scene::Drawable::Pipeline const &b) {
+	if (a.instanced.program != b.instanced.program) return a.instanced.program < b.instanced.program;
+	if (a.instanced.vao != b.instanced.vao) return a.instanced.vao < b.instanced.vao;
+	if (a.type != b.type) return a.type < b.type;
+	if (a.start != b.start) return a.start < b.start;
+	if (a.count != b.count) return a.count < b.count;
+	if (a.index_type != b.index_type) return a.index_type < b.index_type;
+	if (a.base_vertex != b.base_vertex) return a.base_vertex < b.base_vertex;
+	for (uint32_t i = 0; i < Scene::Drawable::Pipeline::TextureCount; ++i) {
+		if (a.textures[i].texture != b.textures[i].texture) return a.textures[i].texture < b.textures[i].texture;
+		if (a.textures[i].target != b.textures[i].target) return a.textures[i].target < b.textures[i].target;
+	}
+	return false;
+}
+
+//matrix that takes stored vertex positions to object space (scale + offset, for quantized positions):
+static glm::mat4 make_stored_to_object(Scene::Drawable::Pipeline const &pipeline) {
+	return glm::mat4(
+		glm::vec4(pipeline.position_scale.x, 0.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, pipeline.position_scale.y, 0.0f, 0.0f),
+		glm::vec4(0.0f, 0.0f, pipeline.position_scale.z, 0.0f),
+		glm::vec4(pipeline.position_offset, 1.0f)
+	);
+}
+
+//issue the draw call for a pipeline's primitives (instanced if instance_count != 1):
+static void draw_primitives(Scene::Drawable::Pipeline const &pipeline, GLsizei instance_count) {
+	if (pipeline.index_type == 0) {
+		if (instance_count == 1) {
+			glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
+		} else {
+			glDrawArraysInstanced(pipeline.type, pipeline.start, pipeline.count, instance_count);
+		}
+	} else {
+		size_t index_size = (pipeline.index_type == GL_UNSIGNED_SHORT ? 2 : 4);
+		GLbyte const *first = (GLbyte const *)0 + pipeline.start * index_size;
+		if (instance_count == 1) {
+			glDrawElementsBaseVertex(pipeline.type, pipeline.count, pipeline.index_type, first, pipeline.base_vertex);
+		} else {
+			glDrawElementsInstancedBaseVertex(pipeline.type, pipeline.count, pipeline.index_type, first, instance_count, pipeline.base_vertex);
+		}
+	}
+}
+
+//packed sort key for the render queue: drawables with equal keys (very likely) share program, vao, and textures:
+static uint64_t state_key(GLuint program, GLuint vao, Scene::Drawable::Pipeline const &pipeline) {
+	//textures beyond the first are rare, so they get folded together:
+	uint32_t other_textures = 0;
+	for (uint32_t i = 1; i < Scene::Drawable::Pipeline::TextureCount; ++i) {
+		other_textures = other_textures * 31 + pipeline.textures[i].texture;
+	}
+	return (uint64_t(program & 0xffff) << 48)
+	     | (uint64_t(vao & 0xffff) << 32)
+	     | (uint64_t(pipeline.textures[0].texture & 0xffff) << 16)
+	     | uint64_t(other_textures & 0xffff);
+}
+
+//the six planes of the frustum described by world_to_clip, as (a,b,c,d) with a*x + b*y + c*z + d >= 0 inside:
+// (Gribb & Hartmann: each clip-space inequality -w <= x,y,z <= w is a plane in world space)
+// n.b. with an infinite projection the far plane has a zero normal and never culls anything
+static void extract_frustum_planes(glm::mat4 const &world_to_clip, glm::vec4 planes[6]) {
+	glm::vec4 row[4];
+	for (uint32_t r = 0; r < 4; ++r) {
+		row[r] = glm::vec4(world_to_clip[0][r], world_to_clip[1][r], world_to_clip[2][r], world_to_clip[3][r]);
+	}
+	planes[0] = row[3] + row[0]; //left
+	planes[1] = row[3] - row[0]; //right
+	planes[2] = row[3] + row[1]; //bottom
+	planes[3] = row[3] - row[1]; //top
+	planes[4] = row[3] + row[2]; //near
+	planes[5] = row[3] - row[2]; //far
+}
+
+//is the drawable's bounding box (moved to world space by 'transform') entirely outside one of the planes?
+static bool outside_frustum(Scene::Drawable const &drawable, Scene::Transform const &transform, glm::vec4 const planes[6]) {
+	if (!(drawable.min.x <= drawable.max.x && drawable.min.y <= drawable.max.y && drawable.min.z <= drawable.max.z)) {
+		return false; //no bounds, so can't tell
+	}
+
+	//world-space AABB of the transformed box, as center + radius:
+	// (the radius along each world axis is the sum of the absolute projections of the box's axes)
+	glm::mat4x3 const &local_to_world = transform.local_to_world();
+	glm::vec3 center = local_to_world * glm::vec4(0.5f * (drawable.min + drawable.max), 1.0f);
+	glm::vec3 half = 0.5f * (drawable.max - drawable.min);
+	glm::vec3 radius = glm::abs(local_to_world[0]) * half.x
+	                 + glm::abs(local_to_world[1]) * half.y
+	                 + glm::abs(local_to_world[2]) * half.z;
+
+	for (uint32_t i = 0; i < 6; ++i) {
+		glm::vec3 n = glm::vec3(planes[i]);
+		//distance (scaled by |n|) of the center from the plane, vs. the box's extent along n:
+		if (glm::dot(n, center) + planes[i].w < -glm::dot(glm::abs(n), radius)) return true;
+	}
+	return false;
+}
+
+//tracks what Scene::draw has bound, so redundant state changes can be skipped (and counted):
+struct GLStateCache {
+	GLStateCache(Scene::DrawStats &stats_) : stats(stats_) { }
+	Scene::DrawStats &stats;
+
+	GLuint program = 0;
+	GLuint vao = 0;
+	Scene::Drawable::Pipeline::TextureInfo textures[Scene::Drawable::Pipeline::TextureCount];
+
+	void use_program(GLuint program_) {
+		if (program_ == program) {
+			stats.program_changes_avoided += 1;
+			return;
+		}
+		glUseProgram(program_);
+		program = program_;
+		stats.program_changes += 1;
+	}
+
+	void bind_vao(GLuint vao_) {
+		if (vao_ == vao) {
+			stats.vao_changes_avoided += 1;
+			return;
+		}
+		glBindVertexArray(vao_);
+		vao = vao_;
+		stats.vao_changes += 1;
+	}
+
+	//bind the textures a pipeline uses (units it doesn't use are cleared, so they don't sample a stale texture):
+	void bind_textures(Scene::Drawable::Pipeline const &pipeline) {
+		for (uint32_t i = 0; i < Scene::Drawable::Pipeline::TextureCount; ++i) {
+			Scene::Drawable::Pipeline::TextureInfo const &want = pipeline.textures[i];
+			Scene::Drawable::Pipeline::TextureInfo &have = textures[i];
+			if (want.texture == 0) {
+				if (have.texture != 0) {
+					glActiveTexture(GL_TEXTURE0 + i);
+					glBindTexture(have.target, 0);
+					have = Scene::Drawable::Pipeline::TextureInfo();
+					stats.texture_changes += 1;
+				}
+				continue;
+			}
+			if (want.texture == have.texture && want.target == have.target) {
+				stats.texture_changes_avoided += 1;
+				continue;
+			}
+			glActiveTexture(GL_TEXTURE0 + i);
+			if (have.texture != 0 && have.target != want.target) {
+				glBindTexture(have.target, 0); //don't leave a texture behind on another target
+			}
+			glBindTexture(want.target, want.texture);
+			have = want;
+			stats.texture_changes += 1;
+		}
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	//un-bind everything (at the end of the draw):
+	void reset() {
+		for (uint32_t i = 0; i < Scene::Drawable::Pipeline::TextureCount; ++i) {
+			if (textures[i].texture != 0) {
+				glActiveTexture(GL_TEXTURE0 + i);
+				glBindTexture(textures[i].target, 0);
+				textures[i] = Scene::Drawable::Pipeline::TextureInfo();
+			}
+		}
+		glActiveTexture(GL_TEXTURE0);
+		glUseProgram(0);
+		program = 0;
+		glBindVertexArray(0);
+		vao = 0;
+	}
+};
+
+//a drawable along with the transform it is drawn with:
+// (usually drawable->transform, but shared drawables are drawn with the drawing scene's copy of it)
+struct DrawItem {
+	Scene::Drawable const *drawable;
+	Scene::Transform const *transform;
+};
+
+static void draw_instanced(std::vector< DrawItem > &batch, glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light, GLStateCache &state);
+
 void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light) const {
+	PROFILE_ZONE("Scene::draw");
+
+	//bring every transform's cached local_to_world() up to date:
+	update_world_matrices();
+
+	draw_stats = DrawStats();
+	GLStateCache state(draw_stats);
+
+	glm::vec4 frustum[6];
+	extract_frustum_planes(world_to_clip, frustum);
+
+	//render queue of drawables that are drawn one at a time, and those that go through the instanced path:
+	// (static so the storage is reused from frame to frame)
+	static std::vector< std::pair< uint64_t, DrawItem > > queue;
+	static std::vector< DrawItem > instanced;
+	queue.clear();
+	instanced.clear();
 
-	//Iterate through all drawables, sending each one to OpenGL:
-	for (auto const &drawable : drawables) {
+	auto submit = [&](Drawable const &drawable, Transform const *transform) {
 		//Reference to drawable's pipeline for convenience:
 		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
 
 		//skip any drawables without a shader program set:
-		if (pipeline.program == 0) continue;
+		if (pipeline.program == 0) return;
 		//skip any drawables that don't reference any vertex array:
-		if (pipeline.vao == 0) continue;
+		if (pipeline.vao == 0) return;
 		//skip any drawables that don't contain any vertices:
-		if (pipeline.count == 0) continue;
+		if (pipeline.count == 0) return;
 
+		assert(transform); //drawables *must* have a transform
+
+		//skip any drawables that are off-screen:
+		if (culling && outside_frustum(drawable, *transform, frustum)) {
+			draw_stats.culled += 1;
+			return;
+		}
+
+		draw_stats.drawables += 1;
+
+		//defer drawables that can be batched:
+		if (instancing && can_instance(drawable)) {
+			instanced.emplace_back(DrawItem{&drawable, transform});
+		} else {
+			queue.emplace_back(state_key(pipeline.program, pipeline.vao, pipeline), DrawItem{&drawable, transform});
+		}
+	};
+	{ PROFILE_ZONE("cull + sort");
+		for (auto const &drawable : drawables) {
+			submit(drawable, drawable.transform);
+		}
+		if (shared_drawables) {
+			assert(shared_drawables->transform_indices.size() == shared_drawables->drawables.size());
+			for (size_t i = 0; i < shared_drawables->drawables.size(); ++i) {
+				submit(shared_drawables->drawables[i], &transforms[shared_drawables->transform_indices[i]]);
+			}
+		}
+
+		//sort by state (stable, so drawables with the same state keep scene order):
+		std::stable_sort(queue.begin(), queue.end(), [](std::pair< uint64_t, DrawItem > const &a, std::pair< uint64_t, DrawItem > const &b) {
+			return a.first < b.first;
+		});
+	}
+
+	//Iterate through the queue, sending each drawable to OpenGL:
+	for (auto const &entry : queue) {
+		Drawable const &drawable = *entry.second.drawable;
+		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
 
 		//Set shader program:
-		glUseProgram(pipeline.program);
+		state.use_program(pipeline.program);
 
 		//Set attribute sources:
-		glBindVertexArray(pipeline.vao);
+		state.bind_vao(pipeline.vao);
 
 		//Configure program uniforms:
 
 		//the object-to-world matrix is used in all three of these uniforms:
-		assert(drawable.transform); //drawables *must* have a transform
-		glm::mat4x3 object_to_world = drawable.transform->make_local_to_world();
+		glm::mat4x3 const &object_to_world = entry.second.transform->local_to_world();
+
+		//(vertex positions may be stored quantized, so position matrices start with the dequantization:)
+		glm::mat4 stored_to_object = make_stored_to_object(pipeline);
 
 		//OBJECT_TO_CLIP takes vertices from object space to clip space:
 		if (pipeline.OBJECT_TO_CLIP_mat4 != -1U) {
-			glm::mat4 object_to_clip = world_to_clip * glm::mat4(object_to_world);
+			glm::mat4 object_to_clip = world_to_clip * glm::mat4(object_to_world) * stored_to_object;
 			glUniformMatrix4fv(pipeline.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
 		}
 
@@ -125,7 +431,8 @@ void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_lig
 
 		//OBJECT_TO_CLIP takes vertices from object space to light space:
 		if (pipeline.OBJECT_TO_LIGHT_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(pipeline.OBJECT_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_light));
+			glm::mat4x3 stored_to_light = object_to_light * stored_to_object;
+			glUniformMatrix4x3fv(pipeline.OBJECT_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(stored_to_light));
 		}
 
 		//NORMAL_TO_CLIP takes normals from object space to light space:
@@ -137,42 +444,122 @@ void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_lig
 		//set any requested custom uniforms:
 		if (pipeline.set_uniforms) pipeline.set_uniforms();
 
-		//set up textures:
-		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
-				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, pipeline.textures[i].texture);
-			}
-		}
+		//set up textures (they stay bound for following drawables that use them):
+		state.bind_textures(pipeline);
 
 		//draw the object:
-		glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
-
-		//un-bind textures:
-		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
-				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, 0);
-			}
-		}
-		glActiveTexture(GL_TEXTURE0);
+		draw_primitives(pipeline, 1);
+		draw_stats.draw_calls += 1;
+	}
 
+	if (!instanced.empty()) {
+		PROFILE_ZONE("draw_instanced");
+		draw_instanced(instanced, world_to_clip, world_to_light, state);
 	}
 
-	glUseProgram(0);
-	glBindVertexArray(0);
+	state.reset();
 
 	GL_ERRORS();
 }
 
+//draws drawables with instanced pipelines, one instanced draw call per batch:
+// note: reorders 'batch' to gather drawables that can share a draw call; expects up-to-date local_to_world()
+static void draw_instanced(std::vector< DrawItem > &batch, glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light, GLStateCache &state) {
+	using Drawable = Scene::Drawable;
+
+	//per-instance transforms live in one buffer texture, shared by all scenes and refilled every draw:
+	static GLuint instance_buffer = 0;
+	static GLuint instance_texture = 0;
+	if (instance_buffer == 0) {
+		glGenBuffers(1, &instance_buffer);
+		glGenTextures(1, &instance_texture);
+		glBindBuffer(GL_TEXTURE_BUFFER, instance_buffer);
+		glBufferData(GL_TEXTURE_BUFFER, 0, nullptr, GL_STREAM_DRAW);
+		glBindTexture(GL_TEXTURE_BUFFER, instance_texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instance_buffer);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	//gather drawables that share a batch (stable, so instances keep scene order within a batch):
+	// (batch_less orders by program and vao first, so batches are also state-sorted)
+	std::stable_sort(batch.begin(), batch.end(), [](DrawItem const &a, DrawItem const &b) {
+		return batch_less(a.drawable->pipeline, b.drawable->pipeline);
+	});
+
+	//six texels (three mat4x3 rows + three mat3 rows) per instance:
+	// (the position matrix includes each mesh's dequantization, the normal matrix doesn't)
+	static std::vector< glm::vec4 > instance_data;
+	instance_data.clear();
+	instance_data.reserve(batch.size() * 6);
+	for (DrawItem const &item : batch) {
+		glm::mat4x3 const &object_to_world = item.transform->local_to_world();
+		glm::mat3 normal_to_world = glm::inverse(glm::transpose(glm::mat3(object_to_world)));
+		glm::mat4x3 stored_to_world = object_to_world * make_stored_to_object(item.drawable->pipeline);
+		for (uint32_t r = 0; r < 3; ++r) {
+			instance_data.emplace_back(stored_to_world[0][r], stored_to_world[1][r], stored_to_world[2][r], stored_to_world[3][r]);
+		}
+		for (uint32_t r = 0; r < 3; ++r) {
+			instance_data.emplace_back(normal_to_world[0][r], normal_to_world[1][r], normal_to_world[2][r], 0.0f);
+		}
+	}
+
+	//orphan last frame's storage and upload this frame's:
+	glBindBuffer(GL_TEXTURE_BUFFER, instance_buffer);
+	glBufferData(GL_TEXTURE_BUFFER, instance_data.size() * sizeof(glm::vec4), instance_data.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glActiveTexture(GL_TEXTURE0 + Drawable::Pipeline::InstanceTextureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, instance_texture);
+	glActiveTexture(GL_TEXTURE0);
+
+	//the world-space normal to light-space normal matrix is the same for every instance:
+	glm::mat3 normal_world_to_light = glm::inverse(glm::transpose(glm::mat3(world_to_light)));
+
+	for (size_t begin = 0; begin < batch.size(); /* later */) {
+		size_t end = begin + 1;
+		while (end < batch.size() && same_batch(batch[begin].drawable->pipeline, batch[end].drawable->pipeline)) ++end;
+
+		Drawable::Pipeline const &pipeline = batch[begin].drawable->pipeline;
+		Drawable::Pipeline::Instanced const &inst = pipeline.instanced;
+
+		state.use_program(inst.program);
+		state.bind_vao(inst.vao);
+
+		if (inst.WORLD_TO_CLIP_mat4 != -1U) {
+			glUniformMatrix4fv(inst.WORLD_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+		}
+		if (inst.WORLD_TO_LIGHT_mat4x3 != -1U) {
+			glUniformMatrix4x3fv(inst.WORLD_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(world_to_light));
+		}
+		if (inst.NORMAL_WORLD_TO_LIGHT_mat3 != -1U) {
+			glUniformMatrix3fv(inst.NORMAL_WORLD_TO_LIGHT_mat3, 1, GL_FALSE, glm::value_ptr(normal_world_to_light));
+		}
+		if (inst.INSTANCE_BASE_int != -1U) {
+			glUniform1i(inst.INSTANCE_BASE_int, GLint(begin));
+		}
+
+		state.bind_textures(pipeline);
+		draw_primitives(pipeline, GLsizei(end - begin));
+		state.stats.draw_calls += 1;
+
+		begin = end;
+	}
+
+	glActiveTexture(GL_TEXTURE0 + Drawable::Pipeline::InstanceTextureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+}
+
 
 void Scene::load(std::string const &filename,
 	std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
 
-	std::ifstream file(filename, std::ios::binary);
+	//read chunks straight out of the mapped file (no intermediate copies):
+	MappedFile file(filename);
+	ChunkReader chunks(file);
 
-	std::vector< char > names;
-	read_chunk(file, "str0", &names);
+	ChunkSpan< char > names = chunks.read_chunk< char >("str0");
 
 	struct HierarchyEntry {
 		uint32_t parent;
@@ -183,8 +570,7 @@ void Scene::load(std::string const &filename,
 		glm::vec3 scale;
 	};
 	static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
-	std::vector< HierarchyEntry > hierarchy;
-	read_chunk(file, "xfh0", &hierarchy);
+	ChunkSpan< HierarchyEntry > hierarchy = chunks.read_chunk< HierarchyEntry >("xfh0");
 
 	struct MeshEntry {
 		uint32_t transform;
@@ -192,8 +578,7 @@ void Scene::load(std::string const &filename,
 		uint32_t name_end;
 	};
 	static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
-	std::vector< MeshEntry > meshes;
-	read_chunk(file, "msh0", &meshes);
+	ChunkSpan< MeshEntry > meshes = chunks.read_chunk< MeshEntry >("msh0");
 
 	struct CameraEntry {
 		uint32_t transform;
@@ -202,8 +587,7 @@ void Scene::load(std::string const &filename,
 		float clip_near, clip_far;
 	};
 	static_assert(sizeof(CameraEntry) == 4 + 4 + 4 + 4 + 4, "CameraEntry is packed.");
-	std::vector< CameraEntry > cameras;
-	read_chunk(file, "cam0", &cameras);
+	ChunkSpan< CameraEntry > cameras = chunks.read_chunk< CameraEntry >("cam0");
 
 	struct LightEntry {
 		uint32_t transform;
@@ -214,8 +598,7 @@ void Scene::load(std::string const &filename,
 		float fov;
 	};
 	static_assert(sizeof(LightEntry) == 4 + 1 + 3 + 4 + 4 + 4, "LightEntry is packed.");
-	std::vector< LightEntry > lights;
-	read_chunk(file, "lmp0", &lights);
+	ChunkSpan< LightEntry > lights = chunks.read_chunk< LightEntry >("lmp0");
 
 
 	//--------------------------------
@@ -225,8 +608,7 @@ void Scene::load(std::string const &filename,
 	hierarchy_transforms.reserve(hierarchy.size());
 
 	for (auto const &h : hierarchy) {
-		transforms.emplace_back();
-		Transform *t = &transforms.back();
+		Transform *t = &transforms.emplace_back();
 		if (h.parent != -1U) {
 			if (h.parent >= hierarchy_transforms.size()) {
 				throw std::runtime_error("scene file '" + filename + "' did not contain transforms in topological-sort order.");
@@ -248,6 +630,9 @@ void Scene::load(std::string const &filename,
 	}
 	assert(hierarchy_transforms.size() == hierarchy.size());
 
+	//(so on_drawable and load_extra can look transforms up by name)
+	index_transforms();
+
 	for (auto const &m : meshes) {
 		if (m.transform >= hierarchy_transforms.size()) {
 			throw std::runtime_error("scene file '" + filename + "' contains mesh entry with invalid transform index (" + std::to_string(m.transform) + ")");
@@ -302,9 +687,11 @@ void Scene::load(std::string const &filename,
 	}
 
 	//load any extra that a subclass wants:
-	load_extra(file, names, hierarchy_transforms);
+	// (it gets the rest of the file as a stream, and its own copy of the -- small -- string table)
+	MemoryStream rest(chunks.position(), chunks.remaining());
+	load_extra(rest, std::vector< char >(names.begin(), names.end()), hierarchy_transforms);
 
-	if (file.peek() != EOF) {
+	if (rest.peek() != EOF) {
 		std::cerr << "WARNING: trailing data in scene file '" << filename << "'" << std::endl;
 	}
 
@@ -314,6 +701,27 @@ void Scene::load(std::string const &filename,
 
 //-------------------------
 
+void Scene::index_transforms() {
+	transform_index.clear();
+	transform_index.reserve(transforms.size());
+	for (size_t i = 0; i < transforms.size(); ++i) {
+		transform_index.insert(hash_name(transforms[i].name), uint32_t(i)); //n.b. keeps the first of any duplicate names
+	}
+}
+
+size_t Scene::find_transform_index(std::string const &name) const {
+	auto f = transform_index.find(hash_name(name));
+	if (!f || *f >= transforms.size() || transforms[*f].name != name) return transforms.size();
+	return *f;
+}
+
+Scene::Transform *Scene::find_transform(std::string const &name) {
+	size_t i = find_transform_index(name);
+	return (i < transforms.size() ? &transforms[i] : nullptr);
+}
+
+//-------------------------
+
 Scene::Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
 	load(filename, on_drawable);
 }
@@ -327,51 +735,92 @@ Scene &Scene::operator=(Scene const &other) {
 	return *this;
 }
 
-void Scene::set(Scene const &other, std::unordered_map< Transform const *, Transform * > *transform_map_) {
+//pointer to the transform in 'to' with the same index as 't' in 'from':
+static Scene::Transform *map_transform(Pool< Scene::Transform > const &from, Pool< Scene::Transform > &to, Scene::Transform const *t) {
+	if (t == nullptr) return nullptr;
+	size_t i = from.index_of(t);
+	assert(i < to.size() && "scene objects must only reference transforms in the same scene");
+	return &to[i];
+}
 
-	std::unordered_map< Transform const *, Transform * > t2t_temp;
-	std::unordered_map< Transform const *, Transform * > &transform_to_transform = *(transform_map_ ? transform_map_ : &t2t_temp);
+void Scene::set(Scene const &other, std::unordered_map< Transform const *, Transform * > *transform_map) {
+	copy_all_but_drawables(other, transform_map);
 
-	transform_to_transform.clear();
+	//copy other's drawables, updating transform pointers:
+	drawables = other.drawables;
+	for (auto &d : drawables) {
+		d.transform = map_transform(other.transforms, transforms, d.transform);
+	}
 
-	//null transform maps to itself:
-	transform_to_transform.insert(std::make_pair(nullptr, nullptr));
+	//(shared drawables refer to transforms by index, so they stay shared)
+	shared_drawables = other.shared_drawables;
+}
 
-	//Copy transforms and store mapping:
+void Scene::snapshot(Scene const &other) {
+	//freeze other's drawables (once) so that all of its snapshots can share them:
+	if (!other.drawables.empty() && (!other.frozen || other.frozen_count != other.drawables.size())) {
+		auto frozen = std::make_shared< SharedDrawables >();
+		frozen->drawables = other.drawables;
+		frozen->transform_indices.reserve(other.drawables.size());
+		for (auto const &d : other.drawables) {
+			assert(other.transforms.index_of(d.transform) < other.transforms.size() && "scene objects must only reference transforms in the same scene");
+			frozen->transform_indices.emplace_back(uint32_t(other.transforms.index_of(d.transform)));
+		}
+		if (other.shared_drawables) {
+			//(already-shared drawables come along, in the same order as draw() visits them)
+			for (size_t i = 0; i < other.shared_drawables->drawables.size(); ++i) {
+				frozen->drawables.emplace_back(other.shared_drawables->drawables[i]);
+				frozen->transform_indices.emplace_back(other.shared_drawables->transform_indices[i]);
+			}
+		}
+		other.frozen = frozen;
+		other.frozen_count = other.drawables.size();
+	}
+
+	copy_all_but_drawables(other, nullptr);
+	drawables.clear();
+	shared_drawables = (other.drawables.empty() ? other.shared_drawables : other.frozen);
+}
+
+void Scene::copy_all_but_drawables(Scene const &other, std::unordered_map< Transform const *, Transform * > *transform_map) {
+	//Copy transforms (in order, so each has the same index as its original):
 	transforms.clear();
+	transforms.reserve(other.transforms.size());
 	for (auto const &t : other.transforms) {
-		transforms.emplace_back();
-		transforms.back().name = t.name;
-		transforms.back().position = t.position;
-		transforms.back().rotation = t.rotation;
-		transforms.back().scale = t.scale;
-		transforms.back().parent = t.parent; //will update later
-
-		//store mapping between transforms old and new:
-		auto ret = transform_to_transform.insert(std::make_pair(&t, &transforms.back()));
-		assert(ret.second);
+		Transform &copy = transforms.emplace_back();
+		copy.name = t.name;
+		copy.position = t.position;
+		copy.rotation = t.rotation;
+		copy.scale = t.scale;
+		copy.parent = t.parent; //will update later
 	}
 
 	//update transform parents:
 	for (auto &t : transforms) {
-		t.parent = transform_to_transform.at(t.parent);
+		t.parent = map_transform(other.transforms, transforms, t.parent);
 	}
+	index_transforms();
 
-	//copy other's drawables, updating transform pointers:
-	drawables = other.drawables;
-	for (auto &d : drawables) {
-		d.transform = transform_to_transform.at(d.transform);
-	}
-
-	//copy other's cameras, updating transform pointers:
+	//copy other's cameras (memcpy'd by the pool), updating transform pointers:
 	cameras = other.cameras;
 	for (auto &c : cameras) {
-		c.transform = transform_to_transform.at(c.transform);
+		c.transform = map_transform(other.transforms, transforms, c.transform);
 	}
 
-	//copy other's lights, updating transform pointers:
+	//copy other's lights (memcpy'd by the pool), updating transform pointers:
 	lights = other.lights;
 	for (auto &l : lights) {
-		l.transform = transform_to_transform.at(l.transform);
+		l.transform = map_transform(other.transforms, transforms, l.transform);
 	}
+
+	if (transform_map) {
+		transform_map->clear();
+		transform_map->insert(std::make_pair(nullptr, nullptr)); //null transform maps to itself
+		for (size_t i = 0; i < transforms.size(); ++i) {
+			transform_map->insert(std::make_pair(&other.transforms[i], &transforms[i]));
+		}
+	}
+
+	instancing = other.instancing;
+	culling = other.culling;
 }
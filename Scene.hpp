@@ -12,11 +12,13 @@
 
 #include "GL.hpp"
 #include "Mesh.hpp"
+#include "NameIndex.hpp"
+#include "Pool.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
-#include <list>
+#include <limits>
 #include <memory>
 #include <functional>
 #include <string>
@@ -44,6 +46,25 @@ struct Scene {
 		glm::mat4x3 make_local_to_world() const;
 		glm::mat4x3 make_world_to_local() const;
 
+		//..or read the local-to-world matrix cached by the last Scene::update_world_matrices() pass:
+		// (only up to date if the pass ran after the last change to this transform or its ancestors)
+		glm::mat4x3 const &local_to_world() const { return world_cache.local_to_world; }
+
+		//cache bookkeeping (mutable so that const scenes can still be updated and drawn):
+		struct WorldCache {
+			glm::mat4x3 local_to_world = glm::mat4x3(1.0f);
+			bool valid = false; //has local_to_world ever been computed?
+			//what local_to_world was computed from, to detect changes without explicit dirty-marking:
+			glm::vec3 position = glm::vec3(0.0f);
+			glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+			glm::vec3 scale = glm::vec3(1.0f);
+			Transform const *parent = nullptr;
+			uint32_t parent_version = 0;
+			uint32_t version = 0; //incremented whenever local_to_world changes, so children know to refresh
+			uint32_t pass = 0; //last update pass that visited this transform
+		};
+		mutable WorldCache world_cache;
+
 		//since hierarchy is tracked through pointers, copy-constructing a transform  is not advised:
 		Transform(Transform const &) = delete;
 		//if we delete some constructors, we need to let the compiler know that the default constructor is still okay:
@@ -55,6 +76,11 @@ struct Scene {
 		Drawable(Transform *transform_) : transform(transform_) { assert(transform); }
 		Transform * transform;
 
+		//object-space bounding box of the drawn vertices (e.g., copied from Mesh::min/max), used for frustum culling:
+		// (the default, empty box means "unknown" -- such drawables are never culled)
+		glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+		glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+
 		//Contains all the data needed to run the OpenGL pipeline:
 		struct Pipeline {
 			GLuint program = 0; //shader program; passed to glUseProgram
@@ -66,6 +92,16 @@ struct Scene {
 			GLuint start = 0; //first vertex to draw; passed to glDrawArrays
 			GLuint count = 0; //number of vertices to draw; passed to glDrawArrays
 
+			//(optional) draw indexed: if index_type is set, 'start' and 'count' are a range of indices in the
+			// vao's element array buffer, drawn with glDrawElementsBaseVertex (copy these from an indexed Mesh):
+			GLenum index_type = 0; //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, or 0 for glDrawArrays
+			GLint base_vertex = 0; //added to every index
+
+			//(optional) dequantization of stored positions (copy these from a Mesh in a compact MeshBuffer):
+			// object-space position = position_offset + position_scale * (Position attribute)
+			glm::vec3 position_offset = glm::vec3(0.0f);
+			glm::vec3 position_scale = glm::vec3(1.0f);
+
 			//uniforms:
 			GLuint OBJECT_TO_CLIP_mat4 = -1U; //uniform location for object to clip space matrix
 			GLuint OBJECT_TO_LIGHT_mat4x3 = -1U; //uniform location for object to light space (== world space) matrix
@@ -79,6 +115,23 @@ struct Scene {
 				GLuint texture = 0;
 				GLenum target = GL_TEXTURE_2D;
 			} textures[TextureCount];
+
+			//(optional) instanced version of the program above, which Scene::draw uses to draw all drawables
+			// with the same program, vao, primitives, and textures (and no set_uniforms) in one instanced draw call:
+			struct Instanced {
+				GLuint program = 0; //shader program; 0 means "don't instance this drawable"
+				GLuint vao = 0; //attrib->buffer mapping for 'program' (same buffer as the vao above)
+
+				//uniforms:
+				GLuint WORLD_TO_CLIP_mat4 = -1U; //uniform location for world to clip space matrix
+				GLuint WORLD_TO_LIGHT_mat4x3 = -1U; //uniform location for world to light space matrix
+				GLuint NORMAL_WORLD_TO_LIGHT_mat3 = -1U; //uniform location for world normal to light space normal matrix
+				GLuint INSTANCE_BASE_int = -1U; //uniform location for the index of this batch's first instance
+
+				//per-instance transforms are read from a buffer texture bound to texture unit InstanceTextureUnit;
+				// instance i occupies six RGBA32F texels: three rows of OBJECT_TO_WORLD (mat4x3), then three rows of NORMAL_TO_WORLD (mat3, w unused).
+			} instanced;
+			enum : uint32_t { InstanceTextureUnit = TextureCount };
 		} pipeline;
 	};
 
@@ -118,21 +171,55 @@ struct Scene {
 	};
 
 	//Scenes, of course, may have many of the above objects:
-	std::list< Transform > transforms;
-	std::list< Drawable > drawables;
-	std::list< Camera > cameras;
-	std::list< Light > lights;
+	// (pools, so pointers to them stay valid as more are added, but without an allocation per object)
+	Pool< Transform > transforms;
+	Pool< Drawable > drawables;
+	Pool< Camera > cameras;
+	Pool< Light > lights;
 	
-	//also track the meshes for all transforms by name
-	static std::unordered_map<std::string, const Mesh *> all_meshes;
+	//also track the meshes for all transforms by name (keyed by hash_name(transform name)):
+	static NameIndex< Mesh const * > all_meshes;
+
+	//look up transforms by name, through an index that load() and set() build:
+	// (call index_transforms() after adding or renaming transforms yourself)
+	// returns nullptr / transforms.size() if there is no such transform; if several share a name, finds the first
+	Transform *find_transform(std::string const &name);
+	size_t find_transform_index(std::string const &name) const;
+	void index_transforms();
+	NameIndex< uint32_t > transform_index; //name hash -> index in transforms
+
+	//batch drawables that have an instanced pipeline into instanced draw calls:
+	bool instancing = true;
+
+	//skip drawables whose (world-space) bounding box is entirely outside the view frustum:
+	bool culling = true;
+
+	//refresh every transform's cached local_to_world() in one top-down pass:
+	// transforms whose position/rotation/scale and ancestors are unchanged since the last pass are skipped.
+	// returns the number of matrices recomputed. (called by draw)
+	uint32_t update_world_matrices() const;
+	mutable uint32_t world_pass = 0; //counts update_world_matrices() calls
 		
 
 	//The "draw" function provides a convenient way to pass all the things in a scene to OpenGL:
+	// n.b. drawables are sorted by GL state (program, vao, textures) rather than drawn in scene order
 	void draw(Camera const &camera) const;
 
 	//..sometimes, you want to draw with a custom projection matrix and/or light space:
 	void draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light = glm::mat4x3(1.0f)) const;
 
+	//counters from the most recent draw(), for judging how well drawables are batched:
+	struct DrawStats {
+		uint32_t drawables = 0; //drawables submitted
+		uint32_t culled = 0; //drawables skipped by frustum culling (not counted in 'drawables')
+		uint32_t draw_calls = 0; //glDraw* calls issued
+		//state changes issued, and those skipped because the state was already current:
+		uint32_t program_changes = 0, program_changes_avoided = 0;
+		uint32_t vao_changes = 0, vao_changes_avoided = 0;
+		uint32_t texture_changes = 0, texture_changes_avoided = 0;
+	};
+	mutable DrawStats draw_stats;
+
 	//add transforms/objects/cameras from a scene file to this scene:
 	// the 'on_drawable' callback gives your code a chance to look up mesh data and make Drawables:
 	// throws on file format errors
@@ -155,4 +242,21 @@ struct Scene {
 	Scene &operator=(Scene const &); //...as scene = scene
 	//... as a set() function that optionally returns the transform->transform mapping:
 	void set(Scene const &, std::unordered_map< Transform const *, Transform * > *transform_map = nullptr);
+
+	//copy-on-write copy: copies transforms, cameras, and lights (the things gameplay changes)
+	// but shares the other scene's drawables, read-only, through shared_drawables:
+	// n.b. changes to the other scene's existing drawables after its first snapshot won't show up in later snapshots
+	void snapshot(Scene const &);
+
+	//drawables shared between scenes (drawn along with 'drawables', using this scene's transforms at transform_indices):
+	struct SharedDrawables {
+		Pool< Drawable > drawables; //(transform pointers refer to the scene they were shared from, so aren't used)
+		std::vector< uint32_t > transform_indices;
+	};
+	std::shared_ptr< SharedDrawables const > shared_drawables;
+
+	//-- internals ---
+	mutable std::shared_ptr< SharedDrawables const > frozen; //this scene's drawables as shared with its snapshots
+	mutable size_t frozen_count = 0; //drawables.size() when 'frozen' was made
+	void copy_all_but_drawables(Scene const &, std::unordered_map< Transform const *, Transform * > *transform_map);
 };
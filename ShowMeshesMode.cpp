@@ -161,6 +161,10 @@ void ShowMeshesMode::select_prev_mesh() {
 		scene_drawable->pipeline.type = f->second.type;
 		scene_drawable->pipeline.start = f->second.start;
 		scene_drawable->pipeline.count = f->second.count;
+		scene_drawable->pipeline.index_type = f->second.index_type;
+		scene_drawable->pipeline.base_vertex = f->second.base_vertex;
+		scene_drawable->pipeline.position_offset = f->second.position_offset;
+		scene_drawable->pipeline.position_scale = f->second.position_scale;
 		current_mesh_min = f->second.min;
 		current_mesh_max = f->second.max;
 	} else {
@@ -168,6 +172,10 @@ void ShowMeshesMode::select_prev_mesh() {
 		scene_drawable->pipeline.type = GL_TRIANGLES;
 		scene_drawable->pipeline.start = 0;
 		scene_drawable->pipeline.count = 0;
+		scene_drawable->pipeline.index_type = 0;
+		scene_drawable->pipeline.base_vertex = 0;
+		scene_drawable->pipeline.position_offset = glm::vec3(0.0f);
+		scene_drawable->pipeline.position_scale = glm::vec3(1.0f);
 		current_mesh_min = glm::vec3(0.0f);
 		current_mesh_max = glm::vec3(0.0f);
 	}
@@ -190,6 +198,10 @@ void ShowMeshesMode::select_next_mesh() {
 		scene_drawable->pipeline.type = f->second.type;
 		scene_drawable->pipeline.start = f->second.start;
 		scene_drawable->pipeline.count = f->second.count;
+		scene_drawable->pipeline.index_type = f->second.index_type;
+		scene_drawable->pipeline.base_vertex = f->second.base_vertex;
+		scene_drawable->pipeline.position_offset = f->second.position_offset;
+		scene_drawable->pipeline.position_scale = f->second.position_scale;
 		current_mesh_min = f->second.min;
 		current_mesh_max = f->second.max;
 	} else {
@@ -197,6 +209,10 @@ void ShowMeshesMode::select_next_mesh() {
 		scene_drawable->pipeline.type = GL_TRIANGLES;
 		scene_drawable->pipeline.start = 0;
 		scene_drawable->pipeline.count = 0;
+		scene_drawable->pipeline.index_type = 0;
+		scene_drawable->pipeline.base_vertex = 0;
+		scene_drawable->pipeline.position_offset = glm::vec3(0.0f);
+		scene_drawable->pipeline.position_scale = glm::vec3(1.0f);
 		current_mesh_min = glm::vec3(0.0f);
 		current_mesh_max = glm::vec3(0.0f);
 	}
@@ -94,9 +94,10 @@ void ShowSceneMode::draw(glm::uvec2 const &drawable_size) {
 	scene.draw(*scene_camera);
 
 	{ //decorate with some lines:
+		//(scene.draw just refreshed the cached world matrices, so no need to walk each parent chain again)
 		DrawLines draw_lines(scene_camera->make_projection() * glm::mat4(scene_camera->transform->make_world_to_local()));
 		for (auto &transform : scene.transforms) {
-			glm::mat4 local_to_world = transform.make_local_to_world();
+			glm::mat4 local_to_world = transform.local_to_world();
 			auto xf = [&local_to_world](glm::vec3 const &vec) {
 				return glm::vec3(local_to_world * glm::vec4(vec, 1.0f));
 			};
@@ -106,7 +107,7 @@ void ShowSceneMode::draw(glm::uvec2 const &drawable_size) {
 
 			if (transform.parent) {
 				//connect to parent:
-				glm::vec3 p = glm::vec3(transform.parent->make_local_to_world()[3]);
+				glm::vec3 p = glm::vec3(transform.parent->local_to_world()[3]);
 				draw_lines.draw(p, xf(glm::vec3(0.0f)), glm::u8vec4(0xff, 0xff, 0x00, 0xff));
 			}
 
@@ -0,0 +1,53 @@
+#pragma once
+
+/*
+ * TripleBuffer< T > hands the latest value from one producer thread to one consumer thread,
+ * without locks and without either side ever waiting for the other:
+ *
+ * TripleBuffer< Frame > mailbox;
+ *
+ * //producer:
+ * Frame &frame = mailbox.write_buffer(); //fill in (slots are re-used, so containers keep their storage)
+ * mailbox.publish();
+ *
+ * //consumer:
+ * mailbox.update(); //true if something new was published since the last update()
+ * Frame const &latest = mailbox.read_buffer();
+ *
+ * The producer and consumer each own one slot; the third is swapped between them through
+ * a single atomic byte. Values published between two update()s are skipped (only the newest is read).
+ *
+ */
+
+#include <atomic>
+#include <cstdint>
+
+template< typename T >
+struct TripleBuffer {
+	//(producer) slot to fill in before publish():
+	T &write_buffer() { return slots[back]; }
+
+	//(producer) make write_buffer() the newest value, and get a fresh slot to write next:
+	void publish() {
+		back = shared.exchange(uint8_t(back | Fresh), std::memory_order_acq_rel) & Index;
+	}
+
+	//(consumer) take the newest value, if there is one; returns false if nothing was published since the last call:
+	bool update() {
+		if (!(shared.load(std::memory_order_relaxed) & Fresh)) return false;
+		front = shared.exchange(front, std::memory_order_acq_rel) & Index;
+		return true;
+	}
+
+	//(consumer) newest value taken by update() (a default-constructed T before anything is published):
+	T const &read_buffer() const { return slots[front]; }
+
+	//-- internals ---
+	static constexpr uint8_t Index = 0x3; //slot index bits of 'shared'
+	static constexpr uint8_t Fresh = 0x4; //set in 'shared' when its slot was published but not yet taken
+
+	T slots[3];
+	uint8_t back = 0; //slot owned by the producer
+	uint8_t front = 1; //slot owned by the consumer
+	std::atomic< uint8_t > shared{2}; //slot in between (plus Fresh flag)
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include "Scene.hpp"
 
+#include <cmath>
 #include <iostream>
 
 #include <glm/glm.hpp>
@@ -9,39 +10,36 @@
 
 inline std::string find_suffix_in_scene(const std::string& name, const std::string& prefix, Scene& scene)
 {
+    const size_t found = scene.find_transform_index(name);
+    if (found == scene.transforms.size()) {
+        throw std::runtime_error("Unable to find mesh: \"" + name + "\" in scene");
+    }
+    // the suffix comes from the first transform after $name (in scene order) whose name contains $prefix
     std::string suffix = "";
-    bool found_name = false;
-    for (auto& transform : scene.transforms) {
-        if (!found_name) {
-            if (transform.name == name) {
-                found_name = true;
-            }
-        } else {
-            if (transform.name.find(prefix) != std::string::npos) {
-                auto const pos = transform.name.find_last_of('.');
-                suffix = transform.name.substr(pos + 1);
-                if (suffix == prefix) {
-                    suffix = ""; // "." not found
-                } else {
-                    // include the . before the suffix (eg. .001, .007)
-                    suffix = "." + suffix;
-                }
-                break;
+    for (size_t i = found + 1; i < scene.transforms.size(); ++i) {
+        const std::string& transform_name = scene.transforms[i].name;
+        if (transform_name.find(prefix) != std::string::npos) {
+            auto const pos = transform_name.find_last_of('.');
+            suffix = transform_name.substr(pos + 1);
+            if (suffix == prefix) {
+                suffix = ""; // "." not found
+            } else {
+                // include the . before the suffix (eg. .001, .007)
+                suffix = "." + suffix;
             }
+            break;
         }
     }
-    if (!found_name) {
-        throw std::runtime_error("Unable to find mesh: \"" + name + "\" in scene");
-    }
     // std::cout << "found suffix to be \"" << suffix << "\"" << std::endl;
     return suffix;
 }
 
 inline glm::vec3 rotate_yaw(const float yaw, const glm::vec3& vec)
 {
-    glm::mat4 rotMat(1);
-    rotMat = glm::rotate(rotMat, yaw, glm::vec3(0, 0, 1.f));
-    return glm::vec3(rotMat * glm::vec4(vec, 1.0));
+    // rotation about z only touches x and y
+    const float c = std::cos(yaw);
+    const float s = std::sin(yaw);
+    return glm::vec3(c * vec.x - s * vec.y, s * vec.x + c * vec.y, vec.z);
 }
 
 inline float repeat(float x, float min, float max)
@@ -0,0 +1,440 @@
+#include "VehicleSystem.hpp"
+
+#include "MappedFile.hpp"
+#include "Profiler.hpp"
+#include "Utils.hpp"
+#include "read_write_chunk.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <stdexcept>
+
+const std::vector<std::string>& VehicleSystem::scene_vehicle_names()
+{
+    static const std::vector<std::string> names = {
+        "car",
+        "car.001",
+        "car.002",
+        "car.003",
+        "car.004",
+        "car.005",
+        "car.006",
+        "car.007",
+        "car.008",
+        "car.009",
+        "car.010",
+        "car.011",
+        "car.012",
+        "car.013",
+        "car.014",
+        "car.015",
+        "car.016",
+        /// TODO: add cars in code, not model
+    };
+    return names;
+}
+
+size_t VehicleSystem::add_from_scene(const std::string& name_, Scene& scene)
+{
+    assert(scene.transforms.size() > 0);
+
+    // find the first (and should be only) instance of $name in scene
+    const std::string suffix = find_suffix_in_scene(name_, "body", scene);
+
+    // get pointers to scene components for convenience:
+    Parts p;
+    const std::pair<std::string, Scene::Transform**> components[] = {
+        { name_, &p.all }, // only the object itself is not suffixed
+        { "body" + suffix, &p.chassis },
+        { "wheel_frontLeft" + suffix, &p.wheel_FL },
+        { "wheel_frontRight" + suffix, &p.wheel_FR },
+        { "wheel_backLeft" + suffix, &p.wheel_BL },
+        { "wheel_backRight" + suffix, &p.wheel_BR },
+    };
+    for (const auto& c : components) {
+        (*c.second) = scene.find_transform(c.first);
+        if ((*c.second) == nullptr) {
+            throw std::runtime_error("Unable to find " + name_ + "'s \"" + c.first + "\" in scene");
+        }
+    }
+
+    const Mesh* const* found = Scene::all_meshes.find(hash_name(p.chassis->name));
+    const Mesh* mesh = (found ? *found : nullptr);
+    if (mesh == nullptr) {
+        throw std::runtime_error("null mesh in chassis (\"" + p.chassis->name + "\") \"" + name_ + "\"!");
+    }
+
+    return add(name_, p, BBox(mesh->min, mesh->max));
+}
+
+size_t VehicleSystem::add_from_cache(const std::string& filename, Scene& scene)
+{
+    MappedFile file(filename);
+    ChunkReader chunks(file);
+
+    // number of transforms in the scene the cache was baked from (a cheap staleness check)
+    ChunkSpan<uint32_t> header = chunks.read_chunk<uint32_t>("vhd0");
+    ChunkSpan<char> strings = chunks.read_chunk<char>("str0");
+    ChunkSpan<Baked> baked = chunks.read_chunk<Baked>("veh0");
+    if (header.size() != 1 || header[0] != scene.transforms.size()) {
+        throw std::runtime_error("Vehicle cache '" + filename + "' was baked from a different scene");
+    }
+
+    // resolve everything before adding anything, so a bad cache leaves the system untouched:
+    std::vector<Parts> resolved(baked.size());
+    for (size_t i = 0; i < baked.size(); ++i) {
+        const Baked& b = baked[i];
+        if (!(b.name_begin <= b.name_end && b.name_end <= strings.size())) {
+            throw std::runtime_error("Vehicle cache '" + filename + "' has an out-of-range name");
+        }
+        const std::pair<uint32_t, Scene::Transform**> components[] = {
+            { b.all, &resolved[i].all },
+            { b.chassis, &resolved[i].chassis },
+            { b.wheel_FL, &resolved[i].wheel_FL },
+            { b.wheel_FR, &resolved[i].wheel_FR },
+            { b.wheel_BL, &resolved[i].wheel_BL },
+            { b.wheel_BR, &resolved[i].wheel_BR },
+        };
+        for (const auto& c : components) {
+            if (c.first >= scene.transforms.size()) {
+                throw std::runtime_error("Vehicle cache '" + filename + "' has an out-of-range transform");
+            }
+            (*c.second) = &scene.transforms[c.first];
+        }
+        // n.b. one comparison per vehicle (not a search) catches scenes that were re-exported with the same transform count:
+        if (resolved[i].all->name.compare(0, std::string::npos, strings.data() + b.name_begin, b.name_end - b.name_begin) != 0) {
+            throw std::runtime_error("Vehicle cache '" + filename + "' was baked from a different scene");
+        }
+    }
+
+    for (size_t i = 0; i < baked.size(); ++i) {
+        add(resolved[i].all->name, resolved[i], BBox(baked[i].min, baked[i].max));
+    }
+    return baked.size();
+}
+
+void VehicleSystem::write_cache(const std::string& filename, const Scene& scene) const
+{
+    auto index_of = [&](const Scene::Transform* transform) {
+        const size_t index = scene.transforms.index_of(transform);
+        if (index == scene.transforms.size()) {
+            throw std::runtime_error("Vehicle part \"" + transform->name + "\" is not in the scene being cached");
+        }
+        return uint32_t(index);
+    };
+
+    std::vector<char> strings;
+    std::vector<Baked> baked;
+    baked.reserve(size());
+    for (size_t i = 0; i < size(); ++i) {
+        Baked b;
+        b.name_begin = uint32_t(strings.size());
+        strings.insert(strings.end(), name[i].begin(), name[i].end());
+        b.name_end = uint32_t(strings.size());
+        b.all = index_of(parts[i].all);
+        b.chassis = index_of(parts[i].chassis);
+        b.wheel_FL = index_of(parts[i].wheel_FL);
+        b.wheel_FR = index_of(parts[i].wheel_FR);
+        b.wheel_BL = index_of(parts[i].wheel_BL);
+        b.wheel_BR = index_of(parts[i].wheel_BR);
+        b.min = bounds[i].min0;
+        b.max = bounds[i].max0;
+        baked.push_back(b);
+    }
+
+    std::ofstream out(filename, std::ios::binary);
+    write_chunk("vhd0", std::vector<uint32_t>(1, uint32_t(scene.transforms.size())), &out);
+    write_chunk("str0", strings, &out);
+    write_chunk("veh0", baked, &out);
+    if (!out) {
+        throw std::runtime_error("Failed to write vehicle cache '" + filename + "'");
+    }
+}
+
+size_t VehicleSystem::add(const std::string& name_, const Parts& parts_, const BBox& bounds_)
+{
+    assert(parts_.all && parts_.chassis && parts_.wheel_FL && parts_.wheel_FR && parts_.wheel_BL && parts_.wheel_BR);
+
+    name.push_back(name_);
+    parts.push_back(parts_);
+    bounds.push_back(bounds_);
+
+    pos.push_back(parts_.all->position);
+    vel.emplace_back(0, 0, 0);
+    accel.push_back(gravity);
+    rot.push_back(glm::eulerAngles(parts_.all->rotation));
+    rotvel.emplace_back(0, 0, 0);
+    collision_force.emplace_back(0, 0, 0);
+
+    throttle.push_back(0.f);
+    brake.push_back(0.f);
+    steer.push_back(0.f);
+
+    woggle.push_back(0.f);
+    wheel_rot.push_back(0.f);
+
+    health.push_back(2.f);
+    timeLastHit.push_back(-1e5f);
+
+    return size() - 1;
+}
+
+void VehicleSystem::swap_remove(size_t i)
+{
+    assert(i < size());
+    const size_t last = size() - 1;
+    auto remove = [i, last](auto& column) {
+        if (i != last) {
+            column[i] = std::move(column[last]);
+        }
+        column.pop_back();
+    };
+    remove(name);
+    remove(parts);
+    remove(bounds);
+    remove(pos);
+    remove(vel);
+    remove(accel);
+    remove(rot);
+    remove(rotvel);
+    remove(collision_force);
+    remove(throttle);
+    remove(brake);
+    remove(steer);
+    remove(woggle);
+    remove(wheel_rot);
+    remove(health);
+    remove(timeLastHit);
+}
+
+void VehicleSystem::for_each_chunk(const std::function<void(size_t, size_t)>& kernel)
+{
+    if (jobs) {
+        jobs->parallel_for(size(), grain, kernel);
+    } else {
+        kernel(0, size());
+    }
+}
+
+void VehicleSystem::think(const float dt)
+{
+    if (size() <= 1) {
+        return;
+    }
+    PROFILE_ZONE("think");
+    for_each_chunk([this, dt](size_t begin, size_t end) { think(dt, begin, end); });
+}
+
+void VehicleSystem::update(const float dt)
+{
+    PROFILE_ZONE("integrate");
+    for_each_chunk([this, dt](size_t begin, size_t end) {
+        PROFILE_ZONE("integrate chunk");
+        integrate(dt, begin, end);
+        update_bounds(begin, end);
+    });
+}
+
+void VehicleSystem::think(const float dt, const size_t begin, const size_t end)
+{
+    PROFILE_ZONE("think chunk");
+    const glm::vec3 target = pos[player];
+    for (size_t i = begin; i < end; i++) {
+        if (i == player) {
+            continue;
+        }
+
+        // get direction to target
+        glm::vec2 dir2D = glm::vec2(target - pos[i]);
+
+        // turn to face the target
+        glm::vec2 heading_swap = glm::vec2(get_heading(i, true));
+
+        // positive when right, negative when left
+        float dot2 = glm::dot(glm::normalize(dir2D), glm::normalize(heading_swap));
+        float angle = std::acos(dot2) - M_PI / 2.f;
+        // whether the target is within the bounds of steering
+        bool forward = (std::fabs(angle) < max_steer);
+        angle = std::min(max_steer, std::max(-max_steer, angle));
+        if (!forward) {
+            angle = -glm::sign(dot2) * float(M_PI / 4);
+        }
+        throttle[i] = glm::min(1.f, 1.f / glm::length(dir2D));
+        steer[i] = angle;
+    }
+}
+
+void VehicleSystem::integrate(const float dt, const size_t begin, const size_t end)
+{
+    for (size_t i = begin; i < end; i++) {
+        woggle[i] += 2 * dt;
+        woggle[i] -= std::floor(woggle[i]);
+
+        const Parts& p = parts[i];
+        if (throttle[i] > 0) {
+            p.chassis->rotation = glm::angleAxis(glm::radians(std::sin(woggle[i] * 2 * float(M_PI))), glm::vec3(0.0f, 1.0f, 0.0f));
+        }
+        // create 3D acceleration vector
+        auto heading = get_heading(i);
+        glm::vec3 a = heading * (throttle_force * throttle[i] - brake_force * brake[i]) + glm::vec3(0, 0, accel[i].z);
+
+        // compute forward speed
+        glm::vec3 v = vel[i];
+        glm::vec3 vel_2D = glm::vec3(v.x, v.y, 0);
+        int velocity_sign = glm::sign(glm::dot(vel_2D, heading));
+        float signed_speed = velocity_sign * glm::length(vel_2D);
+
+        wheel_rot[i] -= dt * signed_speed;
+        const glm::quat roll = glm::angleAxis(wheel_rot[i], glm::vec3(1, 0, 0));
+        const glm::quat steered_roll = glm::angleAxis(steer[i], glm::vec3(0, 0, 1)) * roll;
+        p.wheel_FL->rotation = steered_roll;
+        p.wheel_FR->rotation = steered_roll;
+        // these (rear) wheels are not on a z-axis rotation
+        p.wheel_BL->rotation = roll;
+        p.wheel_BR->rotation = roll;
+
+        glm::vec3 rv = rotvel[i];
+        if (pos[i].z <= 0) { // ground update
+            // inspiration for this physics update was taken from this code:
+            // https://github.com/winstxnhdw/KinematicBicycleModel
+
+            // compute friction
+            float friction = signed_speed * (c_r + c_a * signed_speed);
+            a -= vel_2D * friction; // scale forward velocity by friction
+            const float MAX_ACCEL = 100;
+            a.x = std::min(std::max(a.x, -MAX_ACCEL), MAX_ACCEL);
+            a.y = std::min(std::max(a.y, -MAX_ACCEL), MAX_ACCEL);
+
+            // ensure velocity in x/y is linked to heading
+            v.x = signed_speed * heading.x;
+            v.y = signed_speed * heading.y;
+
+            // compute angular velocity (only along yaw)
+            rv = (signed_speed * glm::tan(steer_force * steer[i]) / wheel_diameter_m) * glm::vec3(0, 0, 1);
+        } else { // in the air
+            a = gravity;
+        }
+
+        // finally perform the physics update
+        v += dt * a;
+        v += dt * collision_force[i];
+
+        // reset collision force until next collision
+        collision_force[i] = glm::vec3(0, 0, 0);
+
+        glm::vec3 x = pos[i];
+        if (x.z <= 0) {
+            // downward velocity is 0 when on the ground
+            v.z = std::max(0.f, v.z);
+        }
+        x += dt * v;
+        x.z = std::max(0.f, x.z);
+
+        // update rotational/angular kinematics
+        glm::vec3 r = rot[i] + dt * rv;
+        normalize(r);
+
+        pos[i] = x;
+        vel[i] = v;
+        accel[i] = a;
+        rot[i] = r;
+        rotvel[i] = rv;
+    }
+}
+
+void VehicleSystem::update_bounds(const size_t begin, const size_t end)
+{
+    for (size_t i = begin; i < end; i++) {
+        // update bounds based off position and rotation
+        bounds[i].update(pos[i], rot[i].z); // only rotate with yaw
+
+        // write the new pose back to the scene
+        parts[i].all->position = pos[i];
+        parts[i].all->rotation = glm::quat(rot[i]); // euler to Quat!
+    }
+}
+
+void VehicleSystem::turn_wheel(size_t i, const float delta)
+{
+    // clamp steer between -pi/4 to pi/4
+    steer[i] = std::min(max_steer, std::max(-max_steer, steer[i] + delta));
+}
+
+bool VehicleSystem::step(const float dt, const float time)
+{
+    think(dt);
+    update(dt);
+    if (time > 1) {
+        collide(dt, time);
+    } else {
+        for (BBox& b : bounds) {
+            b.collided = false;
+        }
+        dead.clear();
+    }
+
+    // a defeated player ends the game before anything is removed
+    if (std::find(dead.begin(), dead.end(), player) != dead.end()) {
+        return false;
+    }
+
+    // delete all dead vehicles (back to front, so swap_remove only moves survivors)
+    for (auto it = dead.rbegin(); it != dead.rend(); it++) {
+        /// TODO: figure out a better/proper way to destroy
+        // move it to under the screen so it is invis
+        parts[*it].all->position = glm::vec3(0, 0, -100);
+        swap_remove(*it);
+    }
+    return true;
+}
+
+void VehicleSystem::collide(const float dt, const float time)
+{
+    PROFILE_ZONE("collide");
+    // broad phase: only pairs that are close enough to touch reach the narrow phase
+    boxes.clear();
+    for (BBox& b : bounds) {
+        b.collided = false;
+        boxes.push_back(&b);
+    }
+    {
+        PROFILE_ZONE("broad phase");
+        broad_phase.find_pairs(boxes);
+    }
+
+    // narrow phase: each vehicle reacts to the first (lowest index) vehicle it hit
+    const uint32_t num_vehicles = uint32_t(size());
+    first_hit.assign(num_vehicles, num_vehicles);
+    // (scalar: on broad phase pairs it beats BBox::collides_with_4, which has to gather every box into lanes;
+    //  see the narrow phase benchmarks in bench.cpp)
+    for (const auto& pair : broad_phase.pairs) {
+        if (bounds[pair.first].collides_with(bounds[pair.second])) {
+            first_hit[pair.first] = std::min(first_hit[pair.first], pair.second);
+            first_hit[pair.second] = std::min(first_hit[pair.second], pair.first);
+        }
+    }
+
+    dead.clear();
+    for (uint32_t i = 0; i < num_vehicles; i++) {
+        if (first_hit[i] == num_vehicles) {
+            continue;
+        }
+        bounds[i].collided = true;
+
+        glm::vec3 heading = get_heading(i);
+        glm::vec3 dir = pos[i] - pos[first_hit[i]]; // scaled by distance
+        collision_force[i] = 0.5f * dir / dt;
+        // check if got bumped
+        if (glm::dot(dir, heading) > 0 && time > timeLastHit[i] + deltaHit) {
+            health[i]--;
+            timeLastHit[i] = time;
+        }
+    }
+
+    // anyone out of health is dead (not just on the tick it ran out, so the player stays dead)
+    for (uint32_t i = 0; i < num_vehicles; i++) {
+        if (health[i] <= 0)
+            dead.push_back(i);
+    }
+}
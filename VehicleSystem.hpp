@@ -0,0 +1,144 @@
+#pragma once
+
+#include "BBox.hpp"
+#include "BroadPhase.hpp"
+#include "JobPool.hpp"
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+// All the four-wheeled vehicles in the arena. Per-vehicle state is stored as parallel
+// (structure-of-arrays) columns so the per-frame kernels stream through contiguous memory.
+// The player is always vehicle 0 (swap_remove never moves the first vehicle unless it is the
+// one being removed).
+struct VehicleSystem {
+    static constexpr size_t player = 0;
+
+    // scene transforms driven by a vehicle
+    struct Parts {
+        Scene::Transform* all = nullptr;
+        Scene::Transform* chassis = nullptr;
+        Scene::Transform *wheel_FL = nullptr, *wheel_FR = nullptr, *wheel_BL = nullptr, *wheel_BR = nullptr;
+    };
+
+    // names of the vehicles placed in world.scene, in spawn order (the first is the player)
+    static const std::vector<std::string>& scene_vehicle_names();
+
+    // find the vehicle called $name (and its body/wheel transforms) in the scene and append it
+    // note: will throw if any of its parts (or the body mesh) are not found
+    size_t add_from_scene(const std::string& name, Scene& scene);
+
+    // vehicle record in a baked cache file (see bake-vehicles.cpp): the parts found by add_from_scene,
+    // as indices into scene.transforms, so loading needs no name lookups
+    struct Baked {
+        uint32_t name_begin, name_end; // vehicle name, in the cache's "str0" chunk
+        uint32_t all, chassis, wheel_FL, wheel_FR, wheel_BL, wheel_BR; // transform indices
+        glm::vec3 min, max; // chassis mesh bounds
+    };
+    static_assert(sizeof(Baked) == 8 * 4 + 6 * 4, "Baked is packed.");
+
+    // append every vehicle in the cache $filename, which must have been baked from the file $scene was loaded from
+    // note: will throw (without adding anything) if the cache can't be read or doesn't match the scene
+    size_t add_from_cache(const std::string& filename, Scene& scene);
+
+    // write all vehicles (whose parts must be transforms in $scene) to a cache file for add_from_cache
+    void write_cache(const std::string& filename, const Scene& scene) const;
+
+    // append a vehicle resting at its "all" transform with the given (unrotated) bounds
+    size_t add(const std::string& name, const Parts& parts, const BBox& bounds);
+
+    // remove vehicle i by moving the last vehicle into its slot (O(1), changes the order)
+    void swap_remove(size_t i);
+
+    size_t size() const { return pos.size(); }
+
+    // advance the whole arena by one tick of dt seconds at world time "time":
+    // think, update, then resolve collisions (bonks only count after the first second).
+    // Vehicles that run out of health are removed.
+    // returns false (and leaves the arena as is) if the player was defeated
+    bool step(float dt, float time);
+
+    // batch kernels (run over every vehicle, split into chunks across "jobs" if set):
+    // determine controls for all non-player vehicles (they drive at the player)
+    void think(float dt);
+    // integrate kinematics, refresh bounds, and write poses back to the scene transforms
+    void update(float dt);
+
+    // the same kernels over vehicles [begin, end). Each only writes the state (and scene transforms)
+    // of its own vehicles, so chunks can run in any order or in parallel with identical results
+    void think(float dt, size_t begin, size_t end);
+    void integrate(float dt, size_t begin, size_t end);
+    void update_bounds(size_t begin, size_t end);
+
+    // optional thread pool for the kernels (collisions are always resolved on the calling thread)
+    JobPool* jobs = nullptr;
+    static constexpr size_t grain = 64; // vehicles per chunk
+
+    // find colliding vehicles, apply bump forces and damage, and collect the dead
+    void collide(float dt, float time);
+
+    // steer vehicle i by delta radians (clamped to the wheel bounds)
+    void turn_wheel(size_t i, float delta);
+
+    glm::vec3 get_heading(size_t i, bool raw = false) const
+    {
+        const float yaw = rot[i].z + (raw ? 0 : (M_PI / 2));
+        return glm::vec3(glm::cos(yaw), glm::sin(yaw), 0);
+    }
+
+    //----- columns -----
+
+    // metadata
+    std::vector<std::string> name;
+    std::vector<Parts> parts;
+    std::vector<BBox> bounds;
+
+    // kinematics
+    std::vector<glm::vec3> pos, vel, accel;
+    std::vector<glm::vec3> rot, rotvel;
+    std::vector<glm::vec3> collision_force;
+
+    // control scheme inputs
+    // throttle and brake are between 0..1, steer is between -PI..PI
+    std::vector<float> throttle, brake, steer;
+
+    // animation
+    std::vector<float> woggle, wheel_rot;
+
+    // gameplay
+    std::vector<float> health; // maximum number of bumps
+    std::vector<float> timeLastHit; // when was the vehicle last hit? (init to negative inf)
+
+    // vehicles that ran out of health in the last collide(), in increasing order
+    std::vector<size_t> dead;
+
+    //----- constants (shared by all vehicles) -----
+
+    constexpr static float deltaHit = 0.25; // minimum time between consecutive hits
+
+    constexpr static glm::vec3 gravity = glm::vec3(0, 0, -9.8);
+
+    // how strong these effects get scaled
+    constexpr static float throttle_force = 10.f;
+    constexpr static float brake_force = 5.f; // brake or reverse?
+    constexpr static float steer_force = 1.f;
+    constexpr static float max_steer = M_PI / 4.f; // wheel bounds are [-max_steer, max_steer]
+
+    constexpr static float wheel_diameter_m = 1.0f;
+    constexpr static float c_r = 0.02f; // coefficient of resistance
+    constexpr static float c_a = 0.025f; // drag coefficient
+
+private:
+    void for_each_chunk(const std::function<void(size_t, size_t)>& kernel);
+
+    // collision scratch space (kept around so the buffers are reused every step)
+    SpatialHash broad_phase;
+    std::vector<const BBox*> boxes;
+    std::vector<uint32_t> first_hit;
+};
@@ -0,0 +1,59 @@
+//Vehicle cache baker:
+// finds the vehicles of a scene by name (VehicleSystem::add_from_scene, the slow part of starting the game)
+// once, offline, and writes what it found -- transform indices and chassis bounds -- for VehicleSystem::add_from_cache.
+//
+//Usage:
+// bake-vehicles <in.scene> <in.pnct> <out.vehicles>
+//
+//Re-run whenever the scene is re-exported (the game falls back to looking vehicles up by name if the cache is stale).
+
+#include "VehicleSystem.hpp"
+#include "Mesh.hpp"
+#include "Scene.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	//when compiled on windows, unhandled exceptions don't have their message printed, which can make debugging simple issues difficult.
+	try {
+#endif
+
+	if (argc != 4) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <in.scene> <in.pnct> <out.vehicles>" << std::endl;
+		return 1;
+	}
+	std::string scene_file = argv[1];
+	std::string meshes_file = argv[2];
+	std::string out_file = argv[3];
+
+	//mesh bounds only (no OpenGL context here, so the data is never uploaded):
+	MeshBuffer meshes(meshes_file, MeshBuffer::VertexFormat::Full, MeshBuffer::DeferUpload);
+
+	//fill in Scene::all_meshes the same way PlayMode does:
+	Scene scene(scene_file, [&meshes](Scene &, Scene::Transform *transform, std::string const &mesh_name) {
+		Scene::all_meshes.set(hash_name(transform->name), &meshes.lookup(mesh_name));
+	});
+
+	VehicleSystem vehicles;
+	for (std::string const &name : VehicleSystem::scene_vehicle_names()) {
+		vehicles.add_from_scene(name, scene);
+	}
+
+	vehicles.write_cache(out_file, scene);
+	std::cout << "Baked " << vehicles.size() << " vehicles from '" << scene_file << "' (" << scene.transforms.size() << " transforms) to '" << out_file << "'." << std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
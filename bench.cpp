@@ -0,0 +1,431 @@
+//car.BONK microbenchmarks:
+// times the per-frame hot paths (box collision tests, vehicle kernels, transform matrices,
+// chunk reading, debug text) on reproducible synthetic data, without a window or OpenGL context.
+//
+//Usage:
+// bench [--warmup N] [--reps N] [--min-time seconds] [--seed N] [--filter substring] [--json file]
+//
+//Each benchmark runs a batch of operations per repetition: the batch size is doubled until one
+// repetition takes at least '--min-time', then '--warmup' repetitions are run and '--reps' are timed.
+// Results are nanoseconds per operation (min/mean/percentiles over repetitions);
+// '--json' also writes them to a file, for comparing revisions.
+
+#include "BBox.hpp"
+#include "BroadPhase.hpp"
+#include "DrawLines.hpp"
+#include "MappedFile.hpp"
+#include "Scene.hpp"
+#include "Utils.hpp"
+#include "VehicleSystem.hpp"
+#include "read_write_chunk.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//keep the compiler from optimizing away results:
+template< typename T >
+static void keep(T const &value) {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r"(&value) : "memory");
+#else
+	static void const * volatile sink;
+	sink = &value;
+#endif
+}
+
+//n.b. std::uniform_real_distribution is implementation-defined, so roll our own to keep runs reproducible across platforms:
+struct Random {
+	Random(uint32_t seed) : mt(seed) { }
+	float operator()() { return float(mt() >> 8) / float(1 << 24); } //in [0,1)
+	std::mt19937 mt;
+};
+
+struct Benchmark {
+	std::string name;
+	//run 'ops' operations:
+	std::function< void(uint64_t ops) > run;
+};
+
+struct Result {
+	std::string name;
+	uint64_t ops; //per repetition
+	std::vector< double > ns_per_op; //one per repetition, sorted
+	double percentile(double p) const {
+		return ns_per_op[std::min(ns_per_op.size() - 1, size_t(p / 100.0 * double(ns_per_op.size())))];
+	}
+	double mean() const {
+		double total = 0.0;
+		for (double ns : ns_per_op) total += ns;
+		return total / double(ns_per_op.size());
+	}
+};
+
+//spawn 'count' cars in a fresh arena (as bonk-sim does):
+static void spawn_cars(Scene &scene, VehicleSystem &vehicles, uint32_t count, uint32_t seed) {
+	Random rand01(seed);
+	BBox const car_bounds(glm::vec3(-1.0f, -2.0f, 0.0f), glm::vec3(1.0f, 2.0f, 1.5f));
+	float const arena_size = 8.0f * std::sqrt(float(count));
+
+	auto make_transform = [&scene](std::string const &name, Scene::Transform *parent) {
+		scene.transforms.emplace_back();
+		Scene::Transform *t = &scene.transforms.back();
+		t->name = name;
+		t->parent = parent;
+		return t;
+	};
+
+	for (uint32_t i = 0; i < count; ++i) {
+		std::string suffix = "." + std::to_string(i);
+		VehicleSystem::Parts parts;
+		parts.all = make_transform("car" + suffix, nullptr);
+		parts.chassis = make_transform("body" + suffix, parts.all);
+		parts.wheel_FL = make_transform("wheel_frontLeft" + suffix, parts.all);
+		parts.wheel_FR = make_transform("wheel_frontRight" + suffix, parts.all);
+		parts.wheel_BL = make_transform("wheel_backLeft" + suffix, parts.all);
+		parts.wheel_BR = make_transform("wheel_backRight" + suffix, parts.all);
+
+		parts.all->position = glm::vec3((rand01() - 0.5f) * arena_size, (rand01() - 0.5f) * arena_size, 0.0f);
+		parts.all->rotation = glm::angleAxis((rand01() * 2.0f - 1.0f) * float(M_PI), glm::vec3(0.0f, 0.0f, 1.0f));
+		parts.wheel_FL->position = glm::vec3(-1.0f, 1.5f, 0.3f);
+		parts.wheel_FR->position = glm::vec3( 1.0f, 1.5f, 0.3f);
+		parts.wheel_BL->position = glm::vec3(-1.0f,-1.5f, 0.3f);
+		parts.wheel_BR->position = glm::vec3( 1.0f,-1.5f, 0.3f);
+
+		vehicles.add(parts.all->name, parts, car_bounds);
+	}
+	vehicles.health[VehicleSystem::player] = 10;
+}
+
+//boxes scattered so that roughly a quarter of random pairs overlap:
+static std::vector< BBox > make_boxes(uint32_t count, Random &rand01) {
+	std::vector< BBox > boxes;
+	boxes.reserve(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		boxes.emplace_back(glm::vec3(-1.0f, -2.0f, 0.0f), glm::vec3(1.0f, 2.0f, 1.5f));
+		boxes.back().update(glm::vec3((rand01() - 0.5f) * 10.0f, (rand01() - 0.5f) * 10.0f, 0.0f), (rand01() * 2.0f - 1.0f) * float(M_PI));
+	}
+	return boxes;
+}
+
+//the original 9-point box test (before the separating axis test replaced it), kept as a reference for BBox::collides_with:
+// (copied as it was, including the per-call point vector and sin/cos per point)
+static bool collides_with_9pt_reference(BBox const &box, BBox const &other) {
+	auto contains_pt = [&box](glm::vec3 const &pt) {
+		glm::vec3 AA_pt = rotate_yaw(-box.rot.z, pt - box.midpt);
+		bool within_x = (AA_pt.x >= box.min0.x && AA_pt.x <= box.max0.x);
+		bool within_y = (AA_pt.y >= box.min0.y && AA_pt.y <= box.max0.y);
+		bool within_z = (pt.z >= box.midpt.z - box.extent.z / 2.f && pt.z <= box.midpt.z + box.extent.z / 2.f);
+		return within_x && within_y && within_z;
+	};
+	glm::vec3 const size = other.extent / 2.f;
+	float const other_yaw = other.rot.z;
+	std::vector< glm::vec3 > check_points = {
+		other.midpt,
+		other.midpt + rotate_yaw(other_yaw, (size * glm::vec3(1, 1, -1))),
+		other.midpt + rotate_yaw(other_yaw, (size * glm::vec3(1, 1, 1))),
+		other.midpt + rotate_yaw(other_yaw, (size * glm::vec3(1, -1, -1))),
+		other.midpt + rotate_yaw(other_yaw, (size * glm::vec3(1, -1, 1))),
+		other.midpt + rotate_yaw(other_yaw, (size * glm::vec3(-1, 1, -1))),
+		other.midpt + rotate_yaw(other_yaw, (size * glm::vec3(-1, 1, 1))),
+		other.midpt + rotate_yaw(other_yaw, (size * glm::vec3(-1, -1, -1))),
+		other.midpt + rotate_yaw(other_yaw, (size * glm::vec3(-1, -1, 1))),
+	};
+	for (glm::vec3 const &pt : check_points) {
+		if (contains_pt(pt)) return true;
+	}
+	return false;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	//when compiled on windows, unhandled exceptions don't have their message printed, which can make debugging simple issues difficult.
+	try {
+#endif
+
+	uint32_t warmup = 3;
+	uint32_t reps = 25;
+	double min_time = 0.005;
+	uint32_t seed = 15466;
+	std::string filter;
+	std::string json_file;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool has_value = (i + 1 < argc);
+		if (arg == "--warmup" && has_value) {
+			warmup = uint32_t(std::stoul(argv[++i]));
+		} else if (arg == "--reps" && has_value) {
+			reps = uint32_t(std::stoul(argv[++i]));
+		} else if (arg == "--min-time" && has_value) {
+			min_time = std::stod(argv[++i]);
+		} else if (arg == "--seed" && has_value) {
+			seed = uint32_t(std::stoul(argv[++i]));
+		} else if (arg == "--filter" && has_value) {
+			filter = argv[++i];
+		} else if (arg == "--json" && has_value) {
+			json_file = argv[++i];
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--warmup N] [--reps N] [--min-time seconds] [--seed N] [--filter substring] [--json file]" << std::endl;
+			return 1;
+		}
+	}
+	if (reps < 1 || !(min_time > 0.0)) {
+		std::cerr << "Need at least one repetition and a positive minimum time." << std::endl;
+		return 1;
+	}
+
+	//------------ benchmark data ------------
+
+	Random rand01(seed);
+
+	std::vector< BBox > boxes = make_boxes(1024, rand01);
+	std::vector< glm::vec3 > points;
+	std::vector< float > yaws;
+	for (uint32_t i = 0; i < 1024; ++i) {
+		points.emplace_back((rand01() - 0.5f) * 10.0f, (rand01() - 0.5f) * 10.0f, rand01() * 2.0f);
+		yaws.emplace_back((rand01() * 2.0f - 1.0f) * float(M_PI));
+	}
+
+	Scene scene;
+	VehicleSystem vehicles;
+	spawn_cars(scene, vehicles, 1000, seed);
+	float const dt = 1.0f / 120.0f;
+
+	//the broad phase's candidate pairs for the spawned cars (close pairs, as the narrow phase sees them):
+	// (the bounds are copied, since the vehicle benchmarks move the cars)
+	vehicles.update_bounds(0, vehicles.size());
+	std::vector< BBox > car_boxes = vehicles.bounds;
+	std::vector< std::pair< uint32_t, uint32_t > > car_pairs;
+	{
+		std::vector< BBox const * > car_box_ptrs;
+		for (BBox const &box : car_boxes) car_box_ptrs.emplace_back(&box);
+		SpatialHash broad_phase;
+		broad_phase.find_pairs(car_box_ptrs);
+		car_pairs = broad_phase.pairs;
+	}
+	if (car_pairs.empty()) throw std::runtime_error("Spawned cars produced no broad phase pairs.");
+
+	//a chunk like the ones in .pnct/.scene files (64k floats):
+	std::string chunk_bytes;
+	{
+		std::vector< glm::vec3 > data(65536 / 3);
+		for (auto &v : data) v = glm::vec3(rand01(), rand01(), rand01());
+		std::ostringstream out;
+		write_chunk("bnch", data, &out);
+		chunk_bytes = out.str();
+	}
+
+	DrawLines lines(glm::mat4(1.0f));
+
+	//------------ benchmarks ------------
+
+	std::vector< Benchmark > benchmarks;
+
+	benchmarks.emplace_back(Benchmark{"BBox 9-point test (reference)", [&](uint64_t ops) {
+		uint32_t hits = 0;
+		for (uint64_t i = 0; i < ops; ++i) {
+			hits += collides_with_9pt_reference(boxes[i & 1023], boxes[(i * 7 + 1) & 1023]);
+		}
+		keep(hits);
+	}});
+
+	benchmarks.emplace_back(Benchmark{"BBox::collides_with", [&](uint64_t ops) {
+		uint32_t hits = 0;
+		for (uint64_t i = 0; i < ops; ++i) {
+			hits += boxes[i & 1023].collides_with(boxes[(i * 7 + 1) & 1023]);
+		}
+		keep(hits);
+	}});
+
+	//(the narrow phase as VehicleSystem::collide runs it; one operation is one pair)
+	benchmarks.emplace_back(Benchmark{"BBox::collides_with_4 (per pair)", [&](uint64_t ops) {
+		uint32_t hits = 0;
+		for (uint64_t i = 0; i < ops; i += 4) {
+			BBox const *a[4];
+			BBox const *b[4];
+			for (uint64_t k = 0; k < 4; ++k) {
+				a[k] = &boxes[(i + k) & 1023];
+				b[k] = &boxes[((i + k) * 7 + 1) & 1023];
+			}
+			hits += BBox::collides_with_4(a, b);
+		}
+		keep(hits);
+	}});
+
+	//the narrow phase on broad phase output (what VehicleSystem::collide should be tuned for; one operation is one pair)
+	benchmarks.emplace_back(Benchmark{"narrow phase collides_with (broad phase pairs)", [&](uint64_t ops) {
+		uint32_t hits = 0;
+		size_t p = 0;
+		for (uint64_t i = 0; i < ops; ++i) {
+			auto const &pair = car_pairs[p];
+			hits += car_boxes[pair.first].collides_with(car_boxes[pair.second]);
+			if (++p == car_pairs.size()) p = 0;
+		}
+		keep(hits);
+	}});
+
+	benchmarks.emplace_back(Benchmark{"narrow phase collides_with_4 (broad phase pairs)", [&](uint64_t ops) {
+		uint32_t hits = 0;
+		size_t p = 0;
+		for (uint64_t i = 0; i < ops; i += 4) {
+			BBox const *a[4];
+			BBox const *b[4];
+			for (uint64_t k = 0; k < 4; ++k) {
+				auto const &pair = car_pairs[p];
+				a[k] = &car_boxes[pair.first];
+				b[k] = &car_boxes[pair.second];
+				if (++p == car_pairs.size()) p = 0;
+			}
+			hits += BBox::collides_with_4(a, b);
+		}
+		keep(hits);
+	}});
+
+	benchmarks.emplace_back(Benchmark{"BBox::contains_pt", [&](uint64_t ops) {
+		uint32_t hits = 0;
+		for (uint64_t i = 0; i < ops; ++i) {
+			hits += boxes[i & 1023].contains_pt(points[(i * 7 + 1) & 1023]);
+		}
+		keep(hits);
+	}});
+
+	benchmarks.emplace_back(Benchmark{"rotate_yaw", [&](uint64_t ops) {
+		glm::vec3 total(0.0f);
+		for (uint64_t i = 0; i < ops; ++i) {
+			total += rotate_yaw(yaws[i & 1023], points[(i * 7 + 1) & 1023]);
+		}
+		keep(total);
+	}});
+
+	//(the per-vehicle kernels; one operation is one vehicle)
+	benchmarks.emplace_back(Benchmark{"VehicleSystem::think (per vehicle)", [&](uint64_t ops) {
+		for (uint64_t done = 0; done < ops; done += vehicles.size()) {
+			vehicles.think(dt, 0, std::min< size_t >(vehicles.size(), size_t(ops - done)));
+		}
+		keep(vehicles.steer[1]);
+	}});
+
+	benchmarks.emplace_back(Benchmark{"VehicleSystem::update (per vehicle)", [&](uint64_t ops) {
+		for (uint64_t done = 0; done < ops; done += vehicles.size()) {
+			size_t end = std::min< size_t >(vehicles.size(), size_t(ops - done));
+			vehicles.integrate(dt, 0, end);
+			vehicles.update_bounds(0, end);
+		}
+		keep(vehicles.pos[1]);
+	}});
+
+	benchmarks.emplace_back(Benchmark{"Transform::make_local_to_world", [&](uint64_t ops) {
+		glm::vec3 total(0.0f);
+		size_t count = scene.transforms.size();
+		for (uint64_t i = 0; i < ops; ++i) {
+			total += scene.transforms[size_t(i % count)].make_local_to_world()[3];
+		}
+		keep(total);
+	}});
+
+	benchmarks.emplace_back(Benchmark{"read_chunk (64 KiB)", [&](uint64_t ops) {
+		std::vector< glm::vec3 > data;
+		for (uint64_t i = 0; i < ops; ++i) {
+			MemoryStream from(chunk_bytes.data(), chunk_bytes.size());
+			read_chunk(from, "bnch", &data);
+			keep(data[0]);
+		}
+	}});
+
+	//(HUD text is mostly the same from frame to frame, so this is the common case)
+	benchmarks.emplace_back(Benchmark{"DrawLines::draw_text (repeated text)", [&](uint64_t ops) {
+		for (uint64_t i = 0; i < ops; ++i) {
+			lines.draw_text("Health: 10", glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(0.2f, 0.0f, 0.0f), glm::vec3(0.0f, 0.2f, 0.0f));
+			keep(lines.attribs.back());
+			lines.attribs.clear();
+		}
+	}});
+
+	benchmarks.emplace_back(Benchmark{"DrawLines::draw_text (new text)", [&](uint64_t ops) {
+		static uint64_t counter = 0;
+		for (uint64_t i = 0; i < ops; ++i) {
+			lines.draw_text("frame " + std::to_string(counter++), glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(0.2f, 0.0f, 0.0f), glm::vec3(0.0f, 0.2f, 0.0f));
+			keep(lines.attribs.back());
+			lines.attribs.clear();
+		}
+	}});
+
+	//------------ run ------------
+
+	auto time_ops = [](Benchmark const &benchmark, uint64_t ops) {
+		auto before = std::chrono::steady_clock::now();
+		benchmark.run(ops);
+		auto after = std::chrono::steady_clock::now();
+		return std::chrono::duration< double >(after - before).count();
+	};
+
+	std::vector< Result > results;
+	for (auto const &benchmark : benchmarks) {
+		if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) continue;
+
+		//grow the batch until it takes long enough to time reliably, then warm up:
+		uint64_t ops = 1;
+		while (time_ops(benchmark, ops) < min_time) ops *= 2;
+		for (uint32_t w = 0; w < warmup; ++w) time_ops(benchmark, ops);
+
+		Result result;
+		result.name = benchmark.name;
+		result.ops = ops;
+		for (uint32_t r = 0; r < reps; ++r) {
+			result.ns_per_op.emplace_back(time_ops(benchmark, ops) * 1.0e9 / double(ops));
+		}
+		std::sort(result.ns_per_op.begin(), result.ns_per_op.end());
+
+		std::cout << result.name << ": " << result.percentile(50.0) << " ns/op median"
+		          << " (min " << result.ns_per_op.front() << ", p90 " << result.percentile(90.0) << ", p99 " << result.percentile(99.0) << ";"
+		          << " " << reps << " x " << ops << " ops)" << std::endl;
+		results.emplace_back(result);
+	}
+
+	if (!json_file.empty()) {
+		std::ofstream out(json_file, std::ios::binary);
+		out << "{\n\t\"seed\": " << seed << ",\n\t\"unit\": \"ns/op\",\n\t\"benchmarks\": [\n";
+		for (auto const &result : results) {
+			out << "\t\t{ \"name\": \"" << result.name << "\""
+			    << ", \"ops\": " << result.ops
+			    << ", \"reps\": " << result.ns_per_op.size()
+			    << ", \"min\": " << result.ns_per_op.front()
+			    << ", \"mean\": " << result.mean()
+			    << ", \"p50\": " << result.percentile(50.0)
+			    << ", \"p90\": " << result.percentile(90.0)
+			    << ", \"p99\": " << result.percentile(99.0)
+			    << ", \"max\": " << result.ns_per_op.back()
+			    << " }" << (&result == &results.back() ? "" : ",") << "\n";
+		}
+		out << "\t]\n}\n";
+		if (!out) {
+			std::cerr << "Failed to write '" << json_file << "'." << std::endl;
+			return 1;
+		}
+		std::cout << "Wrote " << results.size() << " results to '" << json_file << "'." << std::endl;
+	}
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
@@ -0,0 +1,166 @@
+//Headless car.BONK simulation runner:
+// runs the same vehicle logic as PlayMode (VehicleSystem::step) at a fixed timestep,
+// without a window or OpenGL context, and reports how many steps per second it manages.
+//
+//Usage:
+// bonk-sim [--cars N] [--steps N] [--dt seconds] [--seed N] [--threads N]
+//
+//Each match spawns N cars (the first is an idle player) at random poses in a square arena.
+// When a match ends (player bonked out or last one standing) a new one is spawned with the next seed,
+// so long runs double as soak tests.
+//
+//The vehicle kernels run on '--threads' threads (default: 1, i.e., no worker threads);
+// the state checksum does not depend on the thread count.
+
+#include "VehicleSystem.hpp"
+#include "JobPool.hpp"
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+//spawn 'count' cars in a fresh arena:
+static void spawn_arena(Scene &scene, VehicleSystem &vehicles, uint32_t count, uint32_t seed) {
+	scene = Scene();
+	JobPool *jobs = vehicles.jobs;
+	vehicles = VehicleSystem();
+	vehicles.jobs = jobs;
+
+	//n.b. std::uniform_real_distribution is implementation-defined, so roll our own to keep runs reproducible across platforms:
+	std::mt19937 mt(seed);
+	auto rand01 = [&mt]() -> float {
+		return float(mt() >> 8) / float(1 << 24);
+	};
+
+	//roughly the size of the car body in car.blend (forward is +y):
+	BBox const car_bounds(glm::vec3(-1.0f, -2.0f, 0.0f), glm::vec3(1.0f, 2.0f, 1.5f));
+	float const arena_size = 8.0f * std::sqrt(float(count));
+
+	auto make_transform = [&scene](std::string const &name, Scene::Transform *parent) {
+		scene.transforms.emplace_back();
+		Scene::Transform *t = &scene.transforms.back();
+		t->name = name;
+		t->parent = parent;
+		return t;
+	};
+
+	for (uint32_t i = 0; i < count; ++i) {
+		std::string suffix = "." + std::to_string(i);
+		VehicleSystem::Parts parts;
+		parts.all = make_transform("car" + suffix, nullptr);
+		parts.chassis = make_transform("body" + suffix, parts.all);
+		parts.wheel_FL = make_transform("wheel_frontLeft" + suffix, parts.all);
+		parts.wheel_FR = make_transform("wheel_frontRight" + suffix, parts.all);
+		parts.wheel_BL = make_transform("wheel_backLeft" + suffix, parts.all);
+		parts.wheel_BR = make_transform("wheel_backRight" + suffix, parts.all);
+
+		parts.all->position = glm::vec3((rand01() - 0.5f) * arena_size, (rand01() - 0.5f) * arena_size, 0.0f);
+		parts.all->rotation = glm::angleAxis((rand01() * 2.0f - 1.0f) * float(M_PI), glm::vec3(0.0f, 0.0f, 1.0f));
+
+		vehicles.add(parts.all->name, parts, car_bounds);
+	}
+	vehicles.health[VehicleSystem::player] = 10;
+}
+
+//FNV-1a over the simulation state, so runs can be compared for determinism:
+static uint64_t checksum(VehicleSystem const &vehicles) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	auto mix = [&hash](void const *data, size_t size) {
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ reinterpret_cast< uint8_t const * >(data)[i]) * 0x100000001b3ULL;
+		}
+	};
+	mix(vehicles.pos.data(), vehicles.pos.size() * sizeof(glm::vec3));
+	mix(vehicles.vel.data(), vehicles.vel.size() * sizeof(glm::vec3));
+	mix(vehicles.rot.data(), vehicles.rot.size() * sizeof(glm::vec3));
+	mix(vehicles.health.data(), vehicles.health.size() * sizeof(float));
+	return hash;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	//when compiled on windows, unhandled exceptions don't have their message printed, which can make debugging simple issues difficult.
+	try {
+#endif
+
+	uint32_t cars = 17;
+	uint64_t steps = 100000;
+	float dt = 1.0f / 120.0f;
+	uint32_t seed = 15466;
+	uint32_t threads = 1;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool has_value = (i + 1 < argc);
+		if (arg == "--cars" && has_value) {
+			cars = uint32_t(std::stoul(argv[++i]));
+		} else if (arg == "--steps" && has_value) {
+			steps = std::stoull(argv[++i]);
+		} else if (arg == "--dt" && has_value) {
+			dt = std::stof(argv[++i]);
+		} else if (arg == "--seed" && has_value) {
+			seed = uint32_t(std::stoul(argv[++i]));
+		} else if (arg == "--threads" && has_value) {
+			threads = uint32_t(std::stoul(argv[++i]));
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--cars N] [--steps N] [--dt seconds] [--seed N] [--threads N]" << std::endl;
+			return 1;
+		}
+	}
+	if (cars < 1 || !(dt > 0.0f) || threads < 1) {
+		std::cerr << "Need at least one car, a positive timestep, and at least one thread." << std::endl;
+		return 1;
+	}
+
+	std::cout << "Simulating " << steps << " steps of " << dt << "s with " << cars << " cars (seed " << seed << ") on " << threads << " thread(s)." << std::endl;
+
+	JobPool jobs(threads - 1);
+	Scene scene;
+	VehicleSystem vehicles;
+	vehicles.jobs = &jobs;
+	uint32_t match = 0;
+	spawn_arena(scene, vehicles, cars, seed);
+	float time = 0.0f;
+	uint64_t checksum_all = 0;
+
+	auto before = std::chrono::steady_clock::now();
+	for (uint64_t s = 0; s < steps; ++s) {
+		time += dt;
+		bool player_alive = vehicles.step(dt, time);
+		if (!player_alive || vehicles.size() == 1) {
+			//match over, start the next one:
+			checksum_all ^= checksum(vehicles) + match;
+			match += 1;
+			spawn_arena(scene, vehicles, cars, seed + match);
+			time = 0.0f;
+		}
+	}
+	auto after = std::chrono::steady_clock::now();
+
+	checksum_all ^= checksum(vehicles) + match;
+
+	double seconds = std::chrono::duration< double >(after - before).count();
+	std::cout << "Finished " << match << " matches (" << vehicles.size() << " cars left in the current one)." << std::endl;
+	std::cout << "Took " << seconds << "s: " << (seconds > 0.0 ? double(steps) / seconds : 0.0) << " steps/second." << std::endl;
+	std::cout << "State checksum: " << std::hex << checksum_all << std::dec << std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
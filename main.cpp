@@ -7,6 +7,15 @@
 //For asset loading:
 #include "Load.hpp"
 
+//Debug lines are drawn in one batch per frame:
+#include "DrawLines.hpp"
+
+//Timing zones (F12 writes them out):
+#include "Profiler.hpp"
+
+//GPU pass timing (collected once per frame):
+#include "GPUTimer.hpp"
+
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
 
@@ -18,8 +27,10 @@
 
 //...and for c++ standard library functions:
 #include <chrono>
+#include <cmath>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 #include <memory>
 #include <algorithm>
 
@@ -29,6 +40,27 @@ int main(int argc, char **argv) {
 	try {
 #endif
 
+	//------------  options ------------
+
+	//the game is updated at a fixed rate, independent of the frame rate:
+	float tick_rate = 120.0f; //updates per second
+	uint32_t max_ticks = 8; //updates per frame at most; when further behind than that, simulated time is dropped
+	bool sim_thread = false; //simulate on a separate thread (at tick_rate), so slow updates don't delay frames
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--sim-thread") {
+			sim_thread = true;
+		} else if (arg == "--tick-rate" && i + 1 < argc) {
+			tick_rate = std::stof(argv[++i]);
+		} else if (arg == "--max-ticks" && i + 1 < argc) {
+			max_ticks = uint32_t(std::stoul(argv[++i]));
+		}
+	}
+	if (!(tick_rate > 0.0f) || max_ticks < 1) {
+		std::cerr << "Need a positive --tick-rate and at least one --max-ticks." << std::endl;
+		return 1;
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -93,7 +125,7 @@ int main(int argc, char **argv) {
 	call_load_functions();
 
 	//------------ create game mode + make current --------------
-	Mode::set_current(std::make_shared< PlayMode >());
+	Mode::set_current(std::make_shared< PlayMode >(sim_thread, tick_rate));
 
 	//------------ main loop ------------
 
@@ -116,8 +148,10 @@ int main(int argc, char **argv) {
 	while (Mode::current) {
 		//every pass through the game loop creates one frame of output
 		//  by performing three steps:
+		PROFILE_ZONE("frame");
 
 		{ //(1) process any events that are pending
+			PROFILE_ZONE("events");
 			static SDL_Event evt;
 			while (SDL_PollEvent(&evt) == 1) {
 				//handle resizing:
@@ -144,32 +178,55 @@ int main(int argc, char **argv) {
 						px.a = 0xff;
 					}
 					save_png(filename, glm::uvec2(w,h), data.data(), LowerLeftOrigin);
+				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F12) {
+					// --- profile key ---
+					//(covers the last several seconds of frames; see Profiler::RingSize)
+					Profiler::write_chrome_trace("profile.json");
 				}
 			}
 			if (!Mode::current) break;
 		}
 
-		{ //(2) call the current mode's "update" function to deal with elapsed time:
+		{ //(2) call the current mode's "update" function in fixed steps to catch up with elapsed time:
+			PROFILE_ZONE("update");
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
 			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
 			previous_time = current_time;
 
-			//if frames are taking a very long time to process,
-			//lag to avoid spiral of death:
-			elapsed = std::min(0.1f, elapsed);
+			float const tick = 1.0f / tick_rate;
+			static float accumulator = 0.0f; //time not yet simulated
+			accumulator += elapsed;
 
-			Mode::current->update(elapsed);
+			uint32_t ticks = 0;
+			while (accumulator >= tick && Mode::current) {
+				if (ticks == max_ticks) {
+					//if frames are taking a very long time to process,
+					//lag to avoid spiral of death:
+					accumulator = std::fmod(accumulator, tick);
+					break;
+				}
+				Mode::current->update(tick);
+				accumulator -= tick;
+				ticks += 1;
+			}
 			if (!Mode::current) break;
+
+			//the frame is drawn this far between the last update and the next:
+			Mode::current->set_interpolation(accumulator / tick);
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
-		
+			PROFILE_ZONE("draw");
+
 			Mode::current->draw(drawable_size);
+			DrawLines::flush(); //(lines are batched up for the whole frame)
 		}
 
 		//Wait until the recently-drawn frame is shown before doing it all again:
+		PROFILE_ZONE("swap");
 		SDL_GL_SwapWindow(window);
+		GPUTimer::end_frame();
 	}
 
 
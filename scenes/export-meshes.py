@@ -3,6 +3,7 @@
 #based on 'export-sprites.py' and 'glsprite.py' from TCHOW Rainbow; code used is released into the public domain.
 #Patched for 15-466-f19 to remove non-pnct formats!
 #Patched for 15-466-f20 to merge data all at once (slightly faster)
+#Patched to write indexed meshes (deduplicated vertices, "ix16"/"ix32" index chunk, "idx1" mesh index)
 
 #Note: Script meant to be executed within blender 2.9, as per:
 #blender --background --python export-meshes.py -- [...see below...]
@@ -88,13 +89,75 @@ def set_visible(layer_collection):
 
 set_visible(bpy.context.view_layer.layer_collection)
 
-#data contains vertex, normal, color, and texture data from the meshes:
+#reorder triangles for the GPU's post-transform vertex cache, using "Tipsify" from
+# Sander, Nehab, and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007:
+def tipsify(indices, vertex_count, cache_size=16):
+	triangle_count = len(indices) // 3
+	#triangles using each vertex:
+	adjacent = [[] for _ in range(vertex_count)]
+	for t in range(triangle_count):
+		for i in range(3):
+			adjacent[indices[3*t+i]].append(t)
+	live = [len(a) for a in adjacent] #not-yet-emitted triangles using each vertex
+	cache_time = [0] * vertex_count #(fake) time each vertex entered the cache
+	emitted = [False] * triangle_count
+	dead_end = [] #recently used vertices, to restart from when fanning gets stuck
+	time = cache_size + 1
+	cursor = 0 #for restarting from scratch when dead_end is exhausted
+
+	out = []
+	fanning = 0 if vertex_count > 0 else -1
+	while fanning >= 0:
+		candidates = []
+		for t in adjacent[fanning]:
+			if emitted[t]: continue
+			emitted[t] = True
+			for i in range(3):
+				v = indices[3*t+i]
+				out.append(v)
+				dead_end.append(v)
+				candidates.append(v)
+				live[v] -= 1
+				if time - cache_time[v] > cache_size:
+					cache_time[v] = time
+					time += 1
+
+		#next vertex to fan around: the one that will still be in the cache after emitting its triangles, and oldest in it:
+		fanning = -1
+		best_priority = -1
+		for v in candidates:
+			if live[v] <= 0: continue
+			priority = 0
+			if time - cache_time[v] + 2 * live[v] <= cache_size:
+				priority = time - cache_time[v]
+			if priority > best_priority:
+				fanning = v
+				best_priority = priority
+		if fanning == -1:
+			while dead_end:
+				v = dead_end.pop()
+				if live[v] > 0:
+					fanning = v
+					break
+		if fanning == -1:
+			while cursor < vertex_count:
+				if live[cursor] > 0:
+					fanning = cursor
+					break
+				cursor += 1
+	assert(len(out) == len(indices))
+	return out
+
+#vertex data for all meshes (deduplicated, in the order the optimized triangles first use them):
 data = []
 
+#indices (relative to each mesh's first vertex) for all meshes:
+indices = []
+
 #strings contains the mesh names:
 strings = b''
 
-#index gives offsets into the data (and names) for each mesh:
+#index gives offsets into the data, indices (and names) for each mesh:
 index = b''
 
 vertex_count = 0
@@ -133,16 +196,13 @@ for obj in bpy.data.objects:
 	#compute normals (respecting face smoothing):
 	mesh.calc_normals_split()
 
-	#record mesh name, start position and vertex count in the index:
+	#record mesh name in the index:
 	name_begin = len(strings)
 	strings += bytes(name, "utf8")
 	name_end = len(strings)
 	index += struct.pack('I', name_begin)
 	index += struct.pack('I', name_end)
 
-	index += struct.pack('I', vertex_count) #vertex_begin
-	#...count will be written below
-
 	colors = None
 	if len(obj.data.vertex_colors) == 0:
 		print("WARNING: trying to export color data, but object '" + name + "' does not have color data; will output 0xffffffff")
@@ -159,7 +219,10 @@ for obj in bpy.data.objects:
 		if len(obj.data.uv_layers) != 1:
 			print("WARNING: object '" + name + "' has multiple texture coordinate layers; only exporting '" + obj.data.uv_layers.active.name + "'")
 
-	local_data = b''
+	#unique (packed) vertices of this mesh, and the triangles that use them:
+	local_vertices = []
+	local_lookup = dict()
+	local_indices = []
 
 	#write the mesh triangles:
 	for poly in mesh.polygons:
@@ -168,49 +231,81 @@ for obj in bpy.data.objects:
 			assert(mesh.loops[poly.loop_indices[i]].vertex_index == poly.vertices[i])
 			loop = mesh.loops[poly.loop_indices[i]]
 			vertex = mesh.vertices[loop.vertex_index]
+			v = b''
 			for x in vertex.co:
-				local_data += struct.pack('f', x)
+				v += struct.pack('f', x)
 			for x in loop.normal:
-				local_data += struct.pack('f', x)
+				v += struct.pack('f', x)
 			if colors != None:
 				col = colors[poly.loop_indices[i]].color
-				local_data += struct.pack('BBBB', int(col[0] * 255), int(col[1] * 255), int(col[2] * 255), 255)
+				v += struct.pack('BBBB', int(col[0] * 255), int(col[1] * 255), int(col[2] * 255), 255)
 			else:
-				local_data += struct.pack('BBBB', 255, 255, 255, 255)
+				v += struct.pack('BBBB', 255, 255, 255, 255)
 			if uvs != None:
 				uv = uvs[poly.loop_indices[i]].uv
-				local_data += struct.pack('ff', uv.x, uv.y)
+				v += struct.pack('ff', uv.x, uv.y)
 			else:
-				local_data += struct.pack('ff', 0, 0)
-		if len(local_data) > 1000:
-			data.append(local_data)
-			local_data = b''
-	vertex_count += len(mesh.polygons) * 3
+				v += struct.pack('ff', 0, 0)
+			#loops that share every attribute (smooth-shaded corners of neighbouring faces) share a vertex:
+			if v not in local_lookup:
+				local_lookup[v] = len(local_vertices)
+				local_vertices.append(v)
+			local_indices.append(local_lookup[v])
+
+	local_indices = tipsify(local_indices, len(local_vertices))
+
+	#renumber vertices in order of first use, so vertex fetches follow the triangle order too:
+	remap = dict()
+	for i in local_indices:
+		if i not in remap:
+			remap[i] = len(remap)
+	ordered = [None] * len(remap)
+	for old_i, new_i in remap.items():
+		ordered[new_i] = local_vertices[old_i]
 
-	data.append(local_data)
+	index += struct.pack('I', vertex_count) #vertex_begin
+	index += struct.pack('I', vertex_count + len(ordered)) #vertex_end
+	index += struct.pack('I', len(indices)) #index_begin
+	index += struct.pack('I', len(indices) + len(local_indices)) #index_end
 
-	index += struct.pack('I', vertex_count) #vertex_end
+	data.extend(ordered)
+	indices.extend(remap[i] for i in local_indices)
+	vertex_count += len(ordered)
+
+	print("  " + str(len(local_indices)) + " corners -> " + str(len(ordered)) + " unique vertices.")
 
 data = b''.join(data)
 
 #check that code created as much data as anticipated:
 assert(vertex_count * (4*3+4*3+1*4+4*2) == len(data))
 
-#write the data chunk and index chunk to an output blob:
+#indices are relative to each mesh's first vertex, so 16 bits are enough unless some mesh is huge:
+if len(indices) == 0 or max(indices) < 0x10000:
+	index_magic = b'ix16'
+	index_data = struct.pack(str(len(indices)) + 'H', *indices)
+else:
+	index_magic = b'ix32'
+	index_data = struct.pack(str(len(indices)) + 'I', *indices)
+
+#write the data chunk, indices, and index chunk to an output blob:
 blob = open(outfile, 'wb')
 #first chunk: the data
 blob.write(struct.pack('4s',b'pnct')) #type
 blob.write(struct.pack('I', len(data))) #length
 blob.write(data)
-#second chunk: the strings
+#second chunk: the triangle indices
+blob.write(struct.pack('4s',index_magic)) #type
+blob.write(struct.pack('I', len(index_data))) #length
+blob.write(index_data)
+#third chunk: the strings
 blob.write(struct.pack('4s',b'str0')) #type
 blob.write(struct.pack('I', len(strings))) #length
 blob.write(strings)
-#third chunk: the index
-blob.write(struct.pack('4s',b'idx0')) #type
+#fourth chunk: the (indexed-mesh) index
+blob.write(struct.pack('4s',b'idx1')) #type
 blob.write(struct.pack('I', len(index))) #length
 blob.write(index)
 wrote = blob.tell()
 blob.close()
 
-print("Wrote " + str(wrote) + " bytes [== " + str(len(data)+8) + " bytes of data + " + str(len(strings)+8) + " bytes of strings + " + str(len(index)+8) + " bytes of index] to '" + outfile + "'")
+print("Wrote " + str(wrote) + " bytes [== " + str(len(data)+8) + " bytes of data + " + str(len(index_data)+8) + " bytes of indices + " + str(len(strings)+8) + " bytes of strings + " + str(len(index)+8) + " bytes of index] to '" + outfile + "'")
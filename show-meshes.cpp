@@ -1,6 +1,7 @@
 #include "Mode.hpp"
 #include "ShowMeshesMode.hpp"
 #include "Load.hpp"
+#include "DrawLines.hpp"
 #include "GL.hpp"
 #include "load_save_png.hpp"
 
@@ -172,6 +173,7 @@ int main(int argc, char **argv) {
 		{ //(3) call the current mode's "draw" function to produce output:
 		
 			Mode::current->draw(drawable_size);
+			DrawLines::flush(); //(lines are batched up for the whole frame)
 		}
 
 		//Wait until the recently-drawn frame is shown before doing it all again:
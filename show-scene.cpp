@@ -1,6 +1,7 @@
 #include "Mode.hpp"
 #include "ShowSceneMode.hpp"
 #include "Load.hpp"
+#include "DrawLines.hpp"
 #include "GL.hpp"
 #include "load_save_png.hpp"
 #include "ShowSceneProgram.hpp"
@@ -120,6 +121,12 @@ int main(int argc, char **argv) {
 				drawable.pipeline.type = mesh.type;
 				drawable.pipeline.start = mesh.start;
 				drawable.pipeline.count = mesh.count;
+				drawable.pipeline.index_type = mesh.index_type;
+				drawable.pipeline.base_vertex = mesh.base_vertex;
+				drawable.pipeline.position_offset = mesh.position_offset;
+				drawable.pipeline.position_scale = mesh.position_scale;
+				drawable.min = mesh.min;
+				drawable.max = mesh.max;
 
 			});
 		} catch (std::exception &e) {
@@ -214,6 +221,7 @@ int main(int argc, char **argv) {
 		{ //(3) call the current mode's "draw" function to produce output:
 		
 			Mode::current->draw(drawable_size);
+			DrawLines::flush(); //(lines are batched up for the whole frame)
 		}
 
 		//Wait until the recently-drawn frame is shown before doing it all again: